@@ -75,6 +75,9 @@ void EEPROM_writeEnable(void)
 *******************************************************************************/
 uint8_t EEPROM_readByte(uint16_t addr) 
 {
+    /* Wait for any write cycle still in progress */
+    EEPROM_waitForWriteComplete();
+    
 	/* Prepare the TX data packet: instruction + address */
 	uint8_t dataTX[3] = {SPI_EEPROM_READ, ((addr & 0xFF00) >> 8 ), (addr & 0x00FF)};
 	
@@ -104,6 +107,9 @@ uint8_t EEPROM_readByte(uint16_t addr)
 *******************************************************************************/
 void EEPROM_writeByte(uint16_t addr, uint8_t dataByte) 
 {
+    /* Wait for any write cycle still in progress */
+    EEPROM_waitForWriteComplete();
+    
     /* Enable WRITE operations */
     EEPROM_writeEnable();
 	
@@ -134,6 +140,9 @@ void EEPROM_writeByte(uint16_t addr, uint8_t dataByte)
 *******************************************************************************/
 void EEPROM_readPage(uint16_t addr, uint8_t* dataRX, uint8_t nBytes) 
 {
+    /* Wait for any write cycle still in progress */
+    EEPROM_waitForWriteComplete();
+    
 	/* Prepare the TX data packet: instruction + address */
 	uint8_t dataTX[3] = {SPI_EEPROM_READ, ((addr & 0xFF00) >> 8), (addr & 0x00FF)};
 	
@@ -164,6 +173,9 @@ void EEPROM_readPage(uint16_t addr, uint8_t* dataRX, uint8_t nBytes)
 *******************************************************************************/
 void EEPROM_writePage(uint16_t addr, uint8_t* data, uint8_t nBytes) 
 {
+    /* Wait for any write cycle still in progress */
+    EEPROM_waitForWriteComplete();
+    
     /* Enable WRITE operations */
     EEPROM_writeEnable();
 	
@@ -498,216 +510,115 @@ uint16_t EEPROM_retrieveLogPages(void)
 ********************************************************************************
 *
 * Summary:
-*   Compute number of logs currently store inside EEPROM memory. 
+*   Read number of logs currently store inside EEPROM memory. 
 *
 * Parameters:  
 *   None.
 *
 * Return:
-*   Number of logs (max: 102).
+*   Number of logs (max: 255).
 *
 *******************************************************************************/
 uint8_t EEPROM_retrieveLogCount(void)
 {
-    // Read log pages count
-    uint16_t page_count = EEPROM_retrieveLogPages();
-    
-    // Return log count
-    return (uint8_t)(page_count / LOG_PAGES_PER_EVENT);
+    // Read log counter register
+    return EEPROM_readByte(CTRL_REG_LOG_COUNT);
 }
 
 
 /*******************************************************************************
-* Function Name: EEPROM_incrementLogCounter
+* Function Name: EEPROM_retrieveLogNextID
 ********************************************************************************
 *
 * Summary:
-*   Increment by 1 number of logs inside the log counter of the EEPROM. 
+*   Read identification number to be assigned to the next stored log. 
 *
 * Parameters:  
 *   None.
 *
 * Return:
-*   None.
-*
-*******************************************************************************/
-void EEPROM_incrementLogCounter(void)
-{
-    // Read number of already written pages
-    uint16_t reg_count = EEPROM_retrieveLogPages();
-    
-    // Avoid variable overflow
-    if (reg_count < SPI_EEPROM_PAGE_COUNT)
-    {
-        // Increment counter
-        reg_count++;
-    
-        // Store data in buffer
-        uint8_t buffer[2];
-        buffer[0] = reg_count & 0x00FF;
-        buffer[1] = (reg_count >> 8) & 0x00FF;
-        
-        // Overwrite registers
-        EEPROM_writePage(CTRL_REG_LOG_PAGES_LOW, buffer, 2);
-        EEPROM_waitForWriteComplete();
-    }
-}
-
-
-/*******************************************************************************
-* Function Name: EEPROM_storeLogData
-********************************************************************************
-*
-* Summary:
-*   Store 64 bytes buffer of log data inside the first available page of EEPROM 
-*   memory. 
-*
-* Parameters:  
-*   Log buffer pointer.
-*
-* Return:
-*   None.
+*   Next log identification number.
 *
 *******************************************************************************/
-void EEPROM_storeLogData(uint8_t* dataPtr)
+uint8_t EEPROM_retrieveLogNextID(void)
 {
-    // Check how many log pages are currently stored
-    uint16_t page_count = EEPROM_retrieveLogPages();
-
-    // Compute first available address 
-    uint16_t page_addr = LOG_DATA_BASE_ADDR + page_count * SPI_EEPROM_PAGE_SIZE;
-    
-    // Check if address is valid
-    if (page_addr <= SPI_EEPROM_SIZE_BYTE - SPI_EEPROM_PAGE_SIZE)
-    {
-        // Write EEPROM page
-        EEPROM_writePage(page_addr, dataPtr, SPI_EEPROM_PAGE_SIZE);
-        EEPROM_waitForWriteComplete();
-    } 
+    // Read next ID register
+    return EEPROM_readByte(CTRL_REG_LOG_NEXT_ID);
 }
 
 
 /*******************************************************************************
-* Function Name: EEPROM_storeLogMessage
+* Function Name: EEPROM_writeLogCounters
 ********************************************************************************
 *
 * Summary:
-*   Store a log type message inside a single page of EEPROM memory at the first
-*   available address. At the end of the writing the fuction also increments
-*   the log pages counter. 
+*   Overwrite log pages counter, log counter and next log ID with a single write
+*   instruction, without waiting for the write cycle to complete. 
 *
 * Parameters:  
-*   Log message.
+*   Number of written log pages, number of logs, next log ID.
 *
 * Return:
 *   None.
 *
 *******************************************************************************/
-void EEPROM_storeLogMessage(log_t message)
+void EEPROM_writeLogCounters(uint16_t pageCount, uint8_t logCount, uint8_t nextID)
 {
-    uint8_t buffer[64];
-    
-    // Updack struct and place data inside buffer
-    LOG_unpackMessage(buffer, &message);
-    
-    // Store buffer in memory
-    EEPROM_storeLogData(buffer);
-    
-    // Increment number of written pages
-    EEPROM_incrementLogCounter();
+    // Store data in buffer
+    uint8_t buffer[4];
+    buffer[0] = pageCount & 0x00FF;
+    buffer[1] = (pageCount >> 8) & 0x00FF;
+    buffer[2] = logCount;
+    buffer[3] = nextID;
+    
+    // Overwrite registers
+    EEPROM_writePage(CTRL_REG_LOG_PAGES_LOW, buffer, 4);
 }
 
 
 /*******************************************************************************
-* Function Name: EEPROM_findLogID
+* Function Name: EEPROM_retrieveLogPageCount
 ********************************************************************************
 *
 * Summary:
-*   Search inside EEPROM memory for a given log identification number.
+*   Read number of pages used by the log starting at the given address from
+*   its event descriptor.
 *
 * Parameters:  
-*   Log identification number.
-*
-* Return:
 *   16-bit address of log.
 *
-* Side effects:
-*   If the log is not found, an invalid address of 0xFFFF is returned.
-*
-*******************************************************************************/
-uint16_t EEPROM_findLogID(uint8_t logID)
-{
-    // Scan every header of each page
-    uint16_t addrPtr = LOG_DATA_BASE_ADDR;
-    while(EEPROM_readByte(addrPtr) != logID)
-    {
-        // Increment to next header address
-        addrPtr += SPI_EEPROM_PAGE_SIZE;
-        
-        // Check if address exeeds memory
-        if (addrPtr >= SPI_EEPROM_SIZE_BYTE)
-        {
-            // Return invalid address
-            return 0xFFFF;
-        }
-    }
-    
-    // If log ID has been found return address
-    return addrPtr;
-}
-
-
-/*******************************************************************************
-* Function Name: EEPROM_retrieveLogData
-********************************************************************************
-*
-* Summary:
-*   Retrieve the log n-th page data given its identification number and fill up
-*   a pre-allocated buffer provided in input.
-*
-* Parameters:  
-*   Buffer pointer, log identification number, index of desired page.
-*
 * Return:
-*   None
+*   Number of log pages.
 *
 *******************************************************************************/
-void EEPROM_retrieveLogData(uint8_t* dataRX, uint8_t logID, uint8_t pageIndex)
+uint8_t EEPROM_retrieveLogPageCount(uint16_t logAddr)
 {
-    // Compute page address
-    uint16_t page_addr = EEPROM_findLogID(logID) + pageIndex*SPI_EEPROM_PAGE_SIZE;
-    
-    // Retrieve 64 byte of data
-    EEPROM_readPage(page_addr, dataRX, SPI_EEPROM_PAGE_SIZE);
+    return EEPROM_readByte(logAddr + LOG_MESSAGE_HEADER_BYTE + LOG_EVENT_DESC_PAGES);
 }
 
 
 /*******************************************************************************
-* Function Name: EEPROM_retrieveLogMessage
+* Function Name: EEPROM_retrieveLogPeak
 ********************************************************************************
 *
 * Summary:
-*   Retrieve the n-th log type message given its identification number.
+*   Read peak squared magnitude of the log starting at the given address from
+*   its event descriptor.
 *
 * Parameters:  
-*   Log identification number, index of desired page.
+*   16-bit address of log.
 *
 * Return:
-*   Log type message.
+*   16-bit peak squared magnitude.
 *
 *******************************************************************************/
-log_t EEPROM_retrieveLogMessage(uint8_t logID, uint8_t pageIndex)
+uint16_t EEPROM_retrieveLogPeak(uint16_t logAddr)
 {
-    // Read 64 byte from page
-    uint8_t buffer[SPI_EEPROM_PAGE_SIZE];
-    EEPROM_retrieveLogData(buffer, logID, pageIndex);
-    
-    // Pack buffer inside log type message
-    log_t msgRX;
-    LOG_packMessage(&msgRX, buffer);
+    // Read both descriptor bytes
+    uint8_t buffer[2];
+    EEPROM_readPage(logAddr + LOG_MESSAGE_HEADER_BYTE + LOG_EVENT_DESC_PEAK_LOW, buffer, 2);
     
-    // Return log message
-    return msgRX;
+    return (buffer[1] << 8) | buffer[0];
 }
 
 
@@ -716,8 +627,9 @@ log_t EEPROM_retrieveLogMessage(uint8_t logID, uint8_t pageIndex)
 ********************************************************************************
 *
 * Summary:
-*   Overwrite all EEPROM log memory with zeros and set reset flag inside
-*   control register psoc status.
+*   Overwrite control registers and all EEPROM log memory with zeros and set
+*   reset flag inside control register psoc status. The statistics ring at the
+*   end of the memory is kept.
 *
 * Parameters:  
 *   None.
@@ -736,7 +648,7 @@ void EEPROM_resetMemory(void)
     uint16_t page_addr = 0x0000;
     
     // Reset all pages
-    for (uint16_t i=1; i<SPI_EEPROM_PAGE_COUNT; i++)
+    for (uint16_t i=0; i<1 + LOG_DATA_PAGE_COUNT; i++)
     {
         // Reset page
         EEPROM_writePage(page_addr, resetBuffer, SPI_EEPROM_PAGE_SIZE);
@@ -48,9 +48,14 @@
     /* EEPROM User defined regiter masks. */
     #define CTRL_REG_PSOC_STATUS    0x0000
     #define CTRL_REG_LOG_PAGES_LOW  0x0008
-    #define CTRL_REG_LOG_PAGES_HIGH 0x0016
+    #define CTRL_REG_LOG_PAGES_HIGH 0x0009
+    #define CTRL_REG_LOG_COUNT      0x000A
+    #define CTRL_REG_LOG_NEXT_ID    0x000B
     #define LOG_DATA_BASE_ADDR      0x0040
-    #define LOG_PAGES_PER_EVENT     5
+    #define LOG_DATA_PAGE_COUNT     (SPI_EEPROM_PAGE_COUNT - 1 - STATS_RING_PAGES)
+    #define STATS_RING_PAGES        64
+    #define STATS_RING_BASE_ADDR    ((SPI_EEPROM_PAGE_COUNT - STATS_RING_PAGES) * SPI_EEPROM_PAGE_SIZE)
+    #define LOG_INVALID_ADDR        0xFFFF
 
     #define CTRL_REG_PSOC_START_STOP_SHIFT  0
     #define CTRL_REG_PSOC_CONFIG_MODE_SHIFT 1
@@ -82,15 +87,13 @@
     uint8_t EEPROM_retrieveResetFlag(void);
     uint16_t EEPROM_retrieveLogPages(void);
     uint8_t EEPROM_retrieveLogCount(void);
-    void EEPROM_incrementLogCounter(void);
+    uint8_t EEPROM_retrieveLogNextID(void);
+    void EEPROM_writeLogCounters(uint16_t pageCount, uint8_t logCount, uint8_t nextID);
     void EEPROM_resetMemory(void);
     
-    /* Log type data read/write functions. */
-    void EEPROM_storeLogData(uint8_t* dataPtr);
-    void EEPROM_storeLogMessage(log_t message);
-    uint16_t EEPROM_findLogID(uint8_t logID);
-    void EEPROM_retrieveLogData(uint8_t* dataRX, uint8_t logID, uint8_t pageIndex);
-    log_t EEPROM_retrieveLogMessage(uint8_t logID, uint8_t pageIndex);
+    /* Log type data read functions. */
+    uint8_t EEPROM_retrieveLogPageCount(uint16_t logAddr);
+    uint16_t EEPROM_retrieveLogPeak(uint16_t logAddr);
 
 #endif
 
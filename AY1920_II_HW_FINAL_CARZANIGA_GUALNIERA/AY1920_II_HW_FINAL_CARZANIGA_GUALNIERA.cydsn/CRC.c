@@ -0,0 +1,54 @@
+/* ========================================
+ *
+ * This file contains the CRC-16/CCITT-FALSE
+ * computation (polynomial 0x1021, initial
+ * value 0xFFFF), the same one of Python
+ * binascii.crc_hqx(data, 0xFFFF).
+ *
+ * Each byte is processed as two nibbles with
+ * a 16 entries table (32 bytes of flash),
+ * which is about 4 times faster than the
+ * bit by bit loop.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "CRC.h"
+
+
+/* CRC of each nibble placed in the top 4 bits. */
+static const uint16_t crc_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+
+/*******************************************************************************
+* Function Name: CRC_update
+********************************************************************************
+*
+* Summary:
+*   Update a running CRC-16 with new data bytes. Start from CRC_INIT.
+*
+* Parameters:  
+*   Running CRC, data pointer, number of bytes.
+*
+* Return:
+*   Updated CRC.
+*
+*******************************************************************************/
+uint16_t CRC_update(uint16_t crc, const uint8_t* dataPtr, uint16_t nBytes)
+{
+    for (uint16_t i=0; i<nBytes; i++)
+    {
+        // High nibble first
+        crc = (crc << 4) ^ crc_table[(crc >> 12) ^ (dataPtr[i] >> 4)];
+        crc = (crc << 4) ^ crc_table[(crc >> 12) ^ (dataPtr[i] & 0x0F)];
+    }
+    
+    return crc;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,27 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the CRC-16 used to
+ * protect data sent over UART.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __CRC_H__
+    
+    #define __CRC_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    
+    /* Useful constants definition. */
+    #define CRC_INIT    0xFFFF  // CRC-16/CCITT-FALSE: poly 0x1021, no reflection, no final xor
+    
+    /* Function prototype declaration. */
+    uint16_t CRC_update(uint16_t crc, const uint8_t* dataPtr, uint16_t nBytes);
+    
+#endif
+
+/* [] END OF FILE */
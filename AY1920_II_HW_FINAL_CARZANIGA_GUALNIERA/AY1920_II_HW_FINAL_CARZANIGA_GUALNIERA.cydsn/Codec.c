@@ -0,0 +1,184 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the lossless codec of IMU rows.
+ *
+ * Consecutive samples of the same axis are
+ * close to each other, so each axis is coded
+ * as its first value followed by differences:
+ *
+ *  d[i] = v[i] - v[i-1]
+ *
+ * Differences are mapped to unsigned values
+ * with the zigzag transform (0, -1, 1, -2, 2
+ * --> 0, 1, 2, 3, 4) and written with a Rice
+ * code of parameter k chosen per axis and per
+ * frame from the mean value:
+ *
+ *  u = zigzag(d) --> [u >> k in unary] [k LSB]
+ *
+ * where the unary part is made of ones closed
+ * by a zero. Unary parts of 12 ones or more
+ * are replaced by 12 ones and the 9-bit value.
+ *
+ * Output layout (bits are MSB first):
+ *
+ *  first X, first Y, first Z   <3 bytes>
+ *  k of X, codes of X          <3 + ... bits>
+ *  k of Y, codes of Y          <3 + ... bits>
+ *  k of Z, codes of Z          <3 + ... bits>
+ *  zero padding to the byte
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Codec.h"
+
+
+/* Bit writer over the output buffer. */
+typedef struct {
+    uint8_t* buffer;
+    uint16_t size;
+    uint16_t length;
+    uint32_t acc;
+    uint8_t bits;
+    uint8_t overflow;
+} codec_writer_t;
+
+
+/*******************************************************************************
+* Function Name: CODEC_putBits
+********************************************************************************
+*
+* Summary:
+*   Append the lowest bits of a value to the output, MSB first. Bytes past the
+*   end of the buffer are discarded and flagged.
+*
+* Parameters:  
+*   Bit writer pointer, value, number of bits (up to 16).
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void CODEC_putBits(codec_writer_t* writer, uint16_t value, uint8_t nBits)
+{
+    writer->acc = (writer->acc << nBits) | (value & ((1UL << nBits) - 1));
+    writer->bits += nBits;
+    
+    // Move complete bytes to the output
+    while (writer->bits >= 8)
+    {
+        writer->bits -= 8;
+        if (writer->length < writer->size)
+        {
+            writer->buffer[writer->length++] = (uint8_t)(writer->acc >> writer->bits);
+        }
+        else
+        {
+            writer->overflow = 1;
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CODEC_getZigzag
+********************************************************************************
+*
+* Summary:
+*   Get zigzag of the difference between a sample and the previous one of the
+*   same axis.
+*
+* Parameters:  
+*   Rows pointer, row index (greater than 0), axis.
+*
+* Return:
+*   Unsigned difference.
+*
+*******************************************************************************/
+static uint16_t CODEC_getZigzag(uint8_t* rows, uint8_t row, uint8_t axis)
+{
+    int16_t delta = (int8_t)rows[3*row + axis] - (int8_t)rows[3*(row-1) + axis];
+    return (delta >= 0) ? (delta << 1) : ((-delta << 1) - 1);
+}
+
+
+/*******************************************************************************
+* Function Name: CODEC_encode
+********************************************************************************
+*
+* Summary:
+*   Compress rows of X, Y, Z int8 values with per-axis delta, zigzag and Rice
+*   coding. Encoding stops as soon as the output does not fit the given size,
+*   so that the caller can send the rows uncompressed instead.
+*
+* Parameters:  
+*   Rows pointer, number of rows, output buffer, size of the output buffer.
+*
+* Return:
+*   Number of output bytes, 0 if the output does not fit.
+*
+*******************************************************************************/
+uint16_t CODEC_encode(uint8_t* rows, uint8_t nRows, uint8_t* output, uint16_t maxBytes)
+{
+    uint32_t start = PROF_start();
+    
+    codec_writer_t writer = {output, maxBytes, 0, 0, 0, 0};
+    
+    // First row as it is
+    for (uint8_t axis=0; axis<3 && nRows>0; axis++)
+    {
+        CODEC_putBits(&writer, rows[axis], 8);
+    }
+    
+    for (uint8_t axis=0; axis<3 && !writer.overflow; axis++)
+    {
+        // Rice parameter: largest k with 2^k not above the mean difference
+        uint16_t sum = 0;
+        for (uint8_t row=1; row<nRows; row++)
+        {
+            sum += CODEC_getZigzag(rows, row, axis);
+        }
+        uint8_t k = 0;
+        while ((k < CODEC_K_MAX) && ((uint32_t)(nRows - 1) << (k + 1)) <= sum)
+        {
+            k++;
+        }
+        CODEC_putBits(&writer, k, CODEC_K_BITS);
+        
+        // Code differences of the axis
+        for (uint8_t row=1; row<nRows && !writer.overflow; row++)
+        {
+            uint16_t value = CODEC_getZigzag(rows, row, axis);
+            uint16_t quotient = value >> k;
+            
+            if (quotient >= CODEC_ESCAPE_QUOTIENT)
+            {
+                // Escape with raw value
+                CODEC_putBits(&writer, 0xFFFF, CODEC_ESCAPE_QUOTIENT);
+                CODEC_putBits(&writer, value, CODEC_ESCAPE_BITS);
+            }
+            else
+            {
+                // Unary quotient closed by a zero, then remainder
+                CODEC_putBits(&writer, 0xFFFE, quotient + 1);
+                CODEC_putBits(&writer, value, k);
+            }
+        }
+    }
+    
+    // Pad last byte with zeros
+    if (writer.bits > 0)
+    {
+        CODEC_putBits(&writer, 0, 8 - writer.bits);
+    }
+    
+    PROF_stop(PROF_CODEC, start);
+    
+    return writer.overflow ? 0 : writer.length;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,32 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the lossless codec
+ * used to compress IMU rows before they are
+ * streamed over UART.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __CODEC_H__
+    
+    #define __CODEC_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "Profiler.h"
+    
+    /* Useful constants definition. */
+    #define CODEC_K_BITS            3   // Rice parameter of each axis (0-7)
+    #define CODEC_K_MAX             7
+    #define CODEC_ESCAPE_QUOTIENT   12  // Longer unary codes are replaced by raw values
+    #define CODEC_ESCAPE_BITS       9   // Zigzag of the difference of two int8 values
+    
+    /* Function prototype declaration. */
+    uint16_t CODEC_encode(uint8_t* rows, uint8_t nRows, uint8_t* output, uint16_t maxBytes);
+    
+#endif
+
+/* [] END OF FILE */
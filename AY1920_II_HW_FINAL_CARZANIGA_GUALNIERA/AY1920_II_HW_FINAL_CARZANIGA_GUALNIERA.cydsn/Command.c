@@ -0,0 +1,842 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the remote command processor.
+ *
+ * The UART RX ISR only moves received bytes
+ * into a ring buffer, while commands are
+ * parsed and executed from the main loop:
+ *
+ *   RX ISR --> [ ring buffer ] --> parser --> job
+ *             head        tail
+ *
+ * -> A command is executed only once its
+ *    opcode and all its argument bytes have
+ *    been received. A partial command is
+ *    discarded after CMD_ARG_TIMEOUT_MS, and
+ *    unknown opcodes are skipped.
+ *
+ * -> Short commands are executed right away.
+ *    Long ones (memory reset, log, catalog
+ *    and statistics download) are jobs run
+ *    one step per loop iteration: a page is
+ *    erased or sent only when the EEPROM is
+ *    not busy and the TX ring buffer has room
+ *    for it, so that FIFO reading and event
+ *    capture are never stalled. Log pages
+ *    are streamed by the pipelined transfer
+ *    (Transfer.c). No command
+ *    is parsed while a job is running.
+ *
+ * -> Short responses are sent over the
+ *    control channel of the UART, downloads
+ *    over the bulk one (Serial.c), so that
+ *    they never wait behind the stream.
+ *
+ * -> The range download sends a span of logs
+ *    in a single response: number of logs,
+ *    then for each log its ID, number of
+ *    pages, all pages read sequentially from
+ *    the EEPROM and a CRC-16 of the record.
+ *    Storage of new events is held meanwhile
+ *    (they wait in the staging queue), so the
+ *    selected logs cannot be replaced.
+ *
+ * -> The image dump sends a span of the raw
+ *    EEPROM memory (32 KB by default) read
+ *    sequentially, in blocks of 256 bytes
+ *    each followed by its CRC-16.
+ *
+ * -> The image restore receives pages with
+ *    their CRC-16 and acknowledges each one
+ *    as soon as its write cycle is started,
+ *    so that the host sends the next page
+ *    while the EEPROM is writing. A page with
+ *    a wrong CRC is rejected and sent again.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Command.h"
+
+
+/* Ring buffer of bytes received over UART. */
+static uint8_t cmd_rx_buffer[CMD_RX_BUFFER_SIZE];
+static volatile uint8_t cmd_rx_head;
+static volatile uint8_t cmd_rx_tail;
+static volatile uint16_t cmd_rx_count;
+
+/* Arrival time of an incomplete command. */
+static uint8_t cmd_waiting;
+static uint32_t cmd_wait_start;
+
+/* Job under execution. */
+static cmd_job_t cmd_job;
+static uint16_t cmd_job_index;
+static uint16_t cmd_job_count;
+static uint8_t cmd_job_started;
+static uint8_t cmd_job_open;
+
+/* Log download status. */
+static uint8_t cmd_log_id;
+
+/* Range download status. */
+static uint8_t cmd_range_mode;
+static uint8_t cmd_range_first;
+static uint8_t cmd_range_last;
+static uint8_t cmd_range_empty;
+
+/* Image dump and restore status. */
+static uint16_t cmd_image_addr;
+static uint16_t cmd_image_remaining;
+static uint32_t cmd_image_time;
+
+
+/*******************************************************************************
+* Function Name: CMD_Init
+********************************************************************************
+*
+* Summary:
+*   Empty the RX ring buffer and stop any job.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CMD_Init(void)
+{
+    cmd_rx_head = 0;
+    cmd_rx_tail = 0;
+    cmd_rx_count = 0;
+    
+    cmd_waiting = 0;
+    cmd_job = CMD_JOB_NONE;
+}
+
+
+/*******************************************************************************
+* Function Name: CMD_pushByte
+********************************************************************************
+*
+* Summary:
+*   Insert a received byte inside the RX ring buffer. It is called by the UART
+*   RX ISR, the byte is dropped if the ring is full.
+*
+* Parameters:  
+*   Received byte.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CMD_pushByte(uint8_t dataByte)
+{
+    if (cmd_rx_count < CMD_RX_BUFFER_SIZE)
+    {
+        cmd_rx_buffer[cmd_rx_head] = dataByte;
+        cmd_rx_head = (cmd_rx_head + 1) & CMD_RX_BUFFER_MASK;
+        cmd_rx_count++;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CMD_popBytes
+********************************************************************************
+*
+* Summary:
+*   Remove bytes from the RX ring buffer.
+*
+* Parameters:  
+*   Destination buffer (NULL to discard bytes), number of bytes.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void CMD_popBytes(uint8_t* dataPtr, uint16_t nBytes)
+{
+    for (uint16_t i=0; i<nBytes; i++)
+    {
+        if (dataPtr != NULL)
+        {
+            dataPtr[i] = cmd_rx_buffer[cmd_rx_tail];
+        }
+        cmd_rx_tail = (cmd_rx_tail + 1) & CMD_RX_BUFFER_MASK;
+    }
+    
+    // Count is shared with the RX ISR
+    uint8_t int_status = CyEnterCriticalSection();
+    cmd_rx_count -= nBytes;
+    CyExitCriticalSection(int_status);
+}
+
+
+/*******************************************************************************
+* Function Name: CMD_getArgBytes
+********************************************************************************
+*
+* Summary:
+*   Get number of argument bytes following an operation code.
+*
+* Parameters:  
+*   Operation code.
+*
+* Return:
+*   Number of argument bytes.
+*
+*******************************************************************************/
+static uint8_t CMD_getArgBytes(uint8_t opCode)
+{
+    switch (opCode)
+    {
+        case (UART_RX_SEND_LOG_ID):
+        case (UART_RX_SET_DSP_STAGES):
+        case (UART_RX_SET_STREAM_MODE):
+        case (UART_RX_SET_STREAM_FORMAT):
+        case (UART_RX_SET_LINK_MODE):
+            return 1;
+        
+        case (UART_RX_SET_TRIGGER):
+            return TRIG_RULE_BYTE;
+        
+        case (UART_RX_SEND_LOG_RANGE):
+            return CMD_RANGE_ARG_BYTE;
+        
+        case (UART_RX_DUMP_IMAGE):
+        case (UART_RX_RESTORE_IMAGE):
+            return CMD_IMAGE_ARG_BYTE;
+        
+        default:
+            return 0;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CMD_execute
+********************************************************************************
+*
+* Summary:
+*   Execute valid operation codes sent remotely via UART in order to read/write
+*   from/to the EEPROM memory:
+*   +--------------------------------------------------------------------------+
+*   | Operation codes:                                                         |
+*   | -> UART_RX_RESET_MEMORY     :   Erase control and log memory pages       |
+*   | -> UART_RX_NUMBER_OF_LOGS   :   Send number of logs currently stored     |
+*   | -> UART_RX_READ_CTRL_REG    :   Send psoc control register content       |
+*   | -> UART_RX_SEND_LOG_ID      :   Send all log pages corresponding to ID   |
+*   | -> UART_RX_QUEUE_STATUS     :   Send staging queue status and counters   |
+*   | -> UART_RX_SEND_CATALOG     :   Send ID, pages and peak of all logs      |
+*   | -> UART_RX_SEND_PROFILE     :   Send CPU cycles of profiled sections     |
+*   | -> UART_RX_SET_DSP_STAGES   :   Select filters of LED and UART stream    |
+*   | -> UART_RX_SET_STREAM_MODE  :   Stream XYZ, orientation or band spectrum |
+*   | -> UART_RX_SET_TRIGGER      :   Configure a software trigger rule        |
+*   | -> UART_RX_SEND_STATISTICS  :   Send long-term statistics records        |
+*   | -> UART_RX_SERIAL_STATUS    :   Send TX ring buffer counters             |
+*   | -> UART_RX_SET_STREAM_FORMAT:   Stream legacy packets or framed FIFO     |
+*   | -> UART_RX_SEND_LOG_RANGE   :   Send a span of logs with CRC of each one |
+*   | -> UART_RX_DUMP_IMAGE       :   Send raw EEPROM memory with block CRC    |
+*   | -> UART_RX_RESTORE_IMAGE    :   Write raw EEPROM memory sent by the host |
+*   | -> UART_RX_SET_LINK_MODE    :   Send channels raw or inside link frames  |
+*   +--------------------------------------------------------------------------+
+*   Long operations only start a job.
+*
+* Parameters:  
+*   Operation code, argument bytes.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void CMD_execute(uint8_t opCode, uint8_t* args)
+{
+    switch (opCode)
+    {
+        case (UART_RX_RESET_MEMORY):
+        {
+            // Stop storing events, then erase one page per step
+            QUEUE_holdDrain(1);
+            cmd_job = CMD_JOB_RESET_MEMORY;
+            cmd_job_index = 0;
+            cmd_job_count = 1 + LOG_DATA_PAGE_COUNT;
+            break;
+        }
+        
+        case (UART_RX_NUMBER_OF_LOGS):
+        {
+            // Read current log counter value
+            uint8_t log_count = EEPROM_retrieveLogCount();
+            
+            // Send byte over UART
+            SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, log_count);
+            break;
+        }
+        
+        case (UART_RX_READ_CTRL_REG):
+        {
+            // Read control register content
+            uint8_t ctrl_reg = EEPROM_readByte(CTRL_REG_PSOC_STATUS);
+            
+            // Send byte over UART
+            SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, ctrl_reg);
+            break;
+        }
+        
+        case (UART_RX_SEND_LOG_ID):
+        {
+            // Keep the log unchanged until the end of the download
+            QUEUE_holdDrain(1);
+            cmd_job = CMD_JOB_SEND_LOG;
+            cmd_log_id = args[0];
+            cmd_job_started = 0;
+            break;
+        }
+        
+        case (UART_RX_SEND_LOG_RANGE):
+        {
+            // Span of log IDs is resolved once the event being stored has its ID
+            cmd_range_mode = args[0];
+            cmd_range_first = args[1];
+            cmd_range_last = args[2];
+            
+            // Keep stored logs unchanged until the end of the download
+            QUEUE_holdDrain(1);
+            cmd_job = CMD_JOB_SEND_LOG_RANGE;
+            cmd_job_index = 0;
+            cmd_job_started = 0;
+            cmd_job_open = 0;
+            break;
+        }
+        
+        case (UART_RX_DUMP_IMAGE):
+        case (UART_RX_RESTORE_IMAGE):
+        {
+            // Start address and length (0 for the whole memory)
+            uint16_t addr = args[0] | (args[1] << 8);
+            uint32_t length = args[2] | (args[3] << 8);
+            if (length == 0)
+            {
+                length = CMD_IMAGE_SIZE;
+            }
+            if (addr >= CMD_IMAGE_SIZE)
+            {
+                length = 0;
+            }
+            else if (addr + length > CMD_IMAGE_SIZE)
+            {
+                length = CMD_IMAGE_SIZE - addr;
+            }
+            
+            if (opCode == UART_RX_RESTORE_IMAGE)
+            {
+                // Only whole pages are written
+                if ((length == 0) || (addr % SPI_EEPROM_PAGE_SIZE) || (length % SPI_EEPROM_PAGE_SIZE))
+                {
+                    SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, 0);
+                    break;
+                }
+                SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, UART_RX_OPERATION_ACK);
+                cmd_job = CMD_JOB_RESTORE_IMAGE;
+            }
+            else
+            {
+                // Send back applied span
+                uint8_t header[CMD_IMAGE_ARG_BYTE] = {addr & 0xFF, (addr >> 8) & 0xFF, length & 0xFF, (length >> 8) & 0xFF};
+                SERIAL_PutArrayWait(SERIAL_CHANNEL_BULK, header, CMD_IMAGE_ARG_BYTE);
+                cmd_job = CMD_JOB_DUMP_IMAGE;
+            }
+            
+            // Keep log memory unchanged until the end of the transfer
+            QUEUE_holdDrain(1);
+            cmd_image_addr = addr;
+            cmd_image_remaining = length;
+            cmd_image_time = LOG_TIMER_OVERFLOW - MAIN_TIMER_ReadCounter();
+            cmd_job_started = 0;
+            cmd_job_open = 0;
+            break;
+        }
+        
+        case (UART_RX_QUEUE_STATUS):
+        {
+            // Pending events and dropped events counters
+            uint8_t status[5];
+            status[0] = QUEUE_getPendingEvents();
+            status[1] = (QUEUE_overflowCount & 0xFF);
+            status[2] = ((QUEUE_overflowCount >> 8) & 0xFF);
+            status[3] = (QUEUE_memoryFullCount & 0xFF);
+            status[4] = ((QUEUE_memoryFullCount >> 8) & 0xFF);
+            
+            // Send bytes over UART
+            SERIAL_PutArrayWait(SERIAL_CHANNEL_CONTROL, status, 5);
+            break;
+        }
+        
+        case (UART_RX_SEND_CATALOG):
+        {
+            // Send number of logs, then one entry per step
+            SERIAL_PutCharWait(SERIAL_CHANNEL_BULK, CATALOG_getCount());
+            cmd_job = CMD_JOB_SEND_CATALOG;
+            cmd_job_index = 0;
+            cmd_job_count = CATALOG_getCount();
+            break;
+        }
+        
+        case (UART_RX_SEND_PROFILE):
+        {
+            // Send cycle statistics of profiled sections
+            PROF_sendData();
+            break;
+        }
+        
+        case (UART_RX_SET_DSP_STAGES):
+        {
+            // Apply desired mask of filter stages
+            DSP_setStages(args[0]);
+            
+            // Send back applied stages
+            SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, DSP_getStages());
+            break;
+        }
+        
+        case (UART_RX_SET_STREAM_MODE):
+        {
+            // Apply desired stream content
+            stream_mode = (args[0] < STREAM_MODES) ? args[0] : STREAM_XYZ;
+            
+            // Send back applied mode
+            SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, stream_mode);
+            break;
+        }
+        
+        case (UART_RX_SET_STREAM_FORMAT):
+        {
+            // Send back applied format
+            SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, FRAME_setFormat(args[0]));
+            break;
+        }
+        
+        case (UART_RX_SET_TRIGGER):
+        {
+            // Notify if rule (index, type, threshold and duration) is applied
+            if (TRIG_setRule(args[0], args[1], args[2] | (args[3] << 8), args[4]))
+            {
+                SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, UART_RX_OPERATION_ACK);
+            }
+            else
+            {
+                SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, 0);
+            }
+            break;
+        }
+        
+        case (UART_RX_SEND_STATISTICS):
+        {
+            // Count valid records first, then send them from the oldest one
+            cmd_job = CMD_JOB_SEND_STATISTICS;
+            cmd_job_index = 0;
+            cmd_job_count = 0;
+            break;
+        }
+        
+        case (UART_RX_SERIAL_STATUS):
+        {
+            // Send dropped bytes and maximum usage of TX ring buffer
+            SERIAL_sendStatus();
+            break;
+        }
+        
+        case (UART_RX_SET_LINK_MODE):
+        {
+            // Send back applied mode, already inside its first frame
+            SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, SERIAL_setLinkMode(args[0]));
+            break;
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CMD_stepJob
+********************************************************************************
+*
+* Summary:
+*   Execute one step of the job under execution. Nothing is done while the
+*   EEPROM is completing a write cycle or the TX ring buffer has no room for
+*   the next block of data.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void CMD_stepJob(void)
+{
+    // Wait for previous write cycle without blocking
+    if (EEPROM_readStatus() & SPI_EEPROM_WRITE_IN_PROGRESS)
+    {
+        return;
+    }
+    
+    switch (cmd_job)
+    {
+        case (CMD_JOB_RESET_MEMORY):
+        {
+            // Wait for the event being stored
+            if (QUEUE_isDraining())
+            {
+                return;
+            }
+            
+            // Erase next page of control and log memory
+            if (cmd_job_index < cmd_job_count)
+            {
+                uint8_t reset_buffer[SPI_EEPROM_PAGE_SIZE];
+                memset(reset_buffer, 0x00, SPI_EEPROM_PAGE_SIZE);
+                EEPROM_writePage(cmd_job_index * SPI_EEPROM_PAGE_SIZE, reset_buffer, SPI_EEPROM_PAGE_SIZE);
+                cmd_job_index++;
+                return;
+            }
+            
+            // Set reset flag and empty catalog of stored logs
+            EEPROM_saveResetFlag(1);
+            CATALOG_Init();
+            QUEUE_holdDrain(0);
+            
+            // Notify that operation is complete
+            SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, UART_RX_OPERATION_ACK);
+            break;
+        }
+        
+        case (CMD_JOB_SEND_LOG):
+        {
+            if (cmd_job_started == 0)
+            {
+                // Wait for the event being stored
+                if (QUEUE_isDraining())
+                {
+                    return;
+                }
+                
+                // Search log first page inside the catalog
+                uint16_t log_addr = CATALOG_findID(cmd_log_id);
+                cmd_job_started = 1;
+                
+                // Send a single empty page if log is not found
+                if (log_addr == LOG_INVALID_ADDR)
+                {
+                    uint8_t empty_page[SPI_EEPROM_PAGE_SIZE];
+                    memset(empty_page, 0, SPI_EEPROM_PAGE_SIZE);
+                    SERIAL_PutArrayWait(SERIAL_CHANNEL_BULK, empty_page, SPI_EEPROM_PAGE_SIZE);
+                    QUEUE_holdDrain(0);
+                    break;
+                }
+                
+                // Stream all log pages as stored inside the EEPROM
+                uint8_t n_pages = EEPROM_retrieveLogPageCount(log_addr);
+                XFER_start(log_addr, n_pages * SPI_EEPROM_PAGE_SIZE, CRC_INIT);
+            }
+            
+            // Keep reading while the UART sends
+            if (XFER_Process() == 0)
+            {
+                return;
+            }
+            
+            // Resume storage of events
+            QUEUE_holdDrain(0);
+            break;
+        }
+        
+        case (CMD_JOB_SEND_LOG_RANGE):
+        {
+            if (cmd_job_started == 0)
+            {
+                // Wait for the event being stored
+                if (QUEUE_isDraining())
+                {
+                    return;
+                }
+                
+                // Select span of log IDs, nothing if no log is newer than the given ID
+                cmd_range_empty = 0;
+                if (cmd_range_mode == CMD_RANGE_NEWER)
+                {
+                    cmd_range_empty = (cmd_range_first == CATALOG_getNewestID());
+                    cmd_range_first = cmd_range_first + 1;
+                    cmd_range_last = CATALOG_getNewestID();
+                }
+                
+                // Send number of selected logs
+                uint8_t count = 0;
+                for (uint8_t i=0; (i<CATALOG_getCount()) && (cmd_range_empty == 0); i++)
+                {
+                    count += CATALOG_isInSpan(i, cmd_range_first, cmd_range_last);
+                }
+                SERIAL_PutCharWait(SERIAL_CHANNEL_BULK, count);
+                cmd_job_started = 1;
+                return;
+            }
+            
+            // Skip logs outside the span
+            while ((cmd_job_index < CATALOG_getCount()) && (cmd_range_empty || !CATALOG_isInSpan(cmd_job_index, cmd_range_first, cmd_range_last)))
+            {
+                cmd_job_index++;
+            }
+            
+            if (cmd_job_index < CATALOG_getCount())
+            {
+                const log_entry_t* entry = CATALOG_getEntry(cmd_job_index);
+                
+                // Record starts with log ID and number of pages
+                if (cmd_job_open == 0)
+                {
+                    uint8_t header[2] = {entry->logID, entry->pages};
+                    SERIAL_PutArrayWait(SERIAL_CHANNEL_BULK, header, 2);
+                    
+                    uint16_t log_addr = LOG_DATA_BASE_ADDR + entry->pageIndex * SPI_EEPROM_PAGE_SIZE;
+                    XFER_start(log_addr, entry->pages * SPI_EEPROM_PAGE_SIZE, CRC_update(CRC_INIT, header, 2));
+                    cmd_job_open = 1;
+                }
+                
+                // Stream log pages as stored inside the EEPROM
+                if (XFER_Process() == 0)
+                {
+                    return;
+                }
+                
+                // Record ends with CRC (little endian)
+                uint16_t crc = XFER_getCrc();
+                uint8_t trailer[2] = {crc & 0xFF, (crc >> 8) & 0xFF};
+                SERIAL_PutArrayWait(SERIAL_CHANNEL_BULK, trailer, 2);
+                cmd_job_open = 0;
+                cmd_job_index++;
+                return;
+            }
+            
+            // Resume storage of events
+            QUEUE_holdDrain(0);
+            break;
+        }
+        
+        case (CMD_JOB_DUMP_IMAGE):
+        {
+            // Wait for the event being stored
+            if (QUEUE_isDraining())
+            {
+                return;
+            }
+            
+            if (cmd_image_remaining > 0)
+            {
+                // Next block of the image
+                if (cmd_job_open == 0)
+                {
+                    uint16_t n_bytes = (cmd_image_remaining < CMD_IMAGE_BLOCK_BYTE) ? cmd_image_remaining : CMD_IMAGE_BLOCK_BYTE;
+                    XFER_start(cmd_image_addr, n_bytes, CRC_INIT);
+                    cmd_image_addr += n_bytes;
+                    cmd_image_remaining -= n_bytes;
+                    cmd_job_open = 1;
+                }
+                
+                // Stream block as stored inside the EEPROM
+                if (XFER_Process() == 0)
+                {
+                    return;
+                }
+                
+                // Block ends with CRC (little endian)
+                uint16_t crc = XFER_getCrc();
+                uint8_t trailer[2] = {crc & 0xFF, (crc >> 8) & 0xFF};
+                SERIAL_PutArrayWait(SERIAL_CHANNEL_BULK, trailer, 2);
+                cmd_job_open = 0;
+                return;
+            }
+            
+            // Resume storage of events
+            QUEUE_holdDrain(0);
+            break;
+        }
+        
+        case (CMD_JOB_RESTORE_IMAGE):
+        {
+            // Wait for the event being stored
+            if (QUEUE_isDraining())
+            {
+                return;
+            }
+            
+            uint32_t now = LOG_TIMER_OVERFLOW - MAIN_TIMER_ReadCounter();
+            if (cmd_image_remaining > 0)
+            {
+                // Wait for page and CRC, unless the host has gone
+                if (cmd_rx_count < SPI_EEPROM_PAGE_SIZE + 2)
+                {
+                    if (now - cmd_image_time <= CMD_IMAGE_TIMEOUT_MS * (LOG_TICK_PER_SECOND / 1000))
+                    {
+                        return;
+                    }
+                    
+                    // Discard partial page, stop restoring and let the host know
+                    CMD_popBytes(NULL, cmd_rx_count);
+                    SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, CMD_IMAGE_ABORT);
+                    cmd_image_remaining = 0;
+                }
+                else
+                {
+                    uint8_t page[SPI_EEPROM_PAGE_SIZE + 2];
+                    CMD_popBytes(page, SPI_EEPROM_PAGE_SIZE + 2);
+                    cmd_image_time = now;
+                    
+                    // Reject corrupted page, host sends it again
+                    uint16_t crc = CRC_update(CRC_INIT, page, SPI_EEPROM_PAGE_SIZE);
+                    if (crc != (page[SPI_EEPROM_PAGE_SIZE] | (page[SPI_EEPROM_PAGE_SIZE + 1] << 8)))
+                    {
+                        SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, 0);
+                        return;
+                    }
+                    
+                    // Start write cycle and let the host send the next page meanwhile
+                    EEPROM_writePage(cmd_image_addr, page, SPI_EEPROM_PAGE_SIZE);
+                    SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, UART_RX_OPERATION_ACK);
+                    cmd_image_addr += SPI_EEPROM_PAGE_SIZE;
+                    cmd_image_remaining -= SPI_EEPROM_PAGE_SIZE;
+                    return;
+                }
+            }
+            
+            // Rebuild RAM state from the restored memory
+            CATALOG_Init();
+            STATS_Init();
+            QUEUE_holdDrain(0);
+            break;
+        }
+        
+        case (CMD_JOB_SEND_CATALOG):
+        {
+            if (SERIAL_getFree(SERIAL_CHANNEL_BULK) < LOG_CATALOG_ENTRY_BYTE)
+            {
+                return;
+            }
+            
+            // Send next catalog entry over UART
+            if (cmd_job_index < cmd_job_count)
+            {
+                CATALOG_sendEntry(cmd_job_index);
+                cmd_job_index++;
+                return;
+            }
+            break;
+        }
+        
+        case (CMD_JOB_SEND_STATISTICS):
+        {
+            if (SERIAL_getFree(SERIAL_CHANNEL_BULK) < STATS_RECORD_BYTE)
+            {
+                return;
+            }
+            
+            uint8_t record[STATS_RECORD_BYTE];
+            
+            // First pass counts valid records
+            if (cmd_job_index < STATS_RECORD_COUNT)
+            {
+                cmd_job_count += STATS_readRecord(cmd_job_index, record);
+                cmd_job_index++;
+                
+                if (cmd_job_index == STATS_RECORD_COUNT)
+                {
+                    SERIAL_PutCharWait(SERIAL_CHANNEL_BULK, cmd_job_count);
+                }
+                return;
+            }
+            
+            // Second pass sends valid records from the oldest one
+            if (cmd_job_index < 2 * STATS_RECORD_COUNT)
+            {
+                if (STATS_readRecord(cmd_job_index - STATS_RECORD_COUNT, record))
+                {
+                    SERIAL_PutArrayWait(SERIAL_CHANNEL_BULK, record, STATS_RECORD_BYTE);
+                }
+                cmd_job_index++;
+                return;
+            }
+            break;
+        }
+        
+        default:
+            break;
+    }
+    
+    // Job is complete
+    cmd_job = CMD_JOB_NONE;
+}
+
+
+/*******************************************************************************
+* Function Name: CMD_Process
+********************************************************************************
+*
+* Summary:
+*   Non-blocking function called at every main loop iteration: it executes one
+*   step of the job under execution or, if there is none, parses and executes
+*   the next complete command of the RX ring buffer.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CMD_Process(void)
+{
+    // Keep executing long operation
+    if (cmd_job != CMD_JOB_NONE)
+    {
+        CMD_stepJob();
+        return;
+    }
+    
+    // Nothing received
+    if (cmd_rx_count == 0)
+    {
+        return;
+    }
+    
+    // Wait for all argument bytes of the command
+    uint8_t op_code = cmd_rx_buffer[cmd_rx_tail];
+    uint8_t n_args = CMD_getArgBytes(op_code);
+    if (cmd_rx_count < 1 + n_args)
+    {
+        uint32_t now = LOG_TIMER_OVERFLOW - MAIN_TIMER_ReadCounter();
+        if (cmd_waiting == 0)
+        {
+            cmd_waiting = 1;
+            cmd_wait_start = now;
+        }
+        else if (now - cmd_wait_start > CMD_ARG_TIMEOUT_MS * (LOG_TICK_PER_SECOND / 1000))
+        {
+            // Discard operation code of partial command
+            CMD_popBytes(NULL, 1);
+            cmd_waiting = 0;
+        }
+        return;
+    }
+    cmd_waiting = 0;
+    
+    // Remove command from the ring and execute it
+    uint8_t args[CMD_MAX_ARG_BYTE];
+    CMD_popBytes(NULL, 1);
+    CMD_popBytes(args, n_args);
+    CMD_execute(op_code, args);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,62 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the remote command
+ * processor, which parses the bytes received
+ * over UART and executes commands from the
+ * main loop.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __COMMAND_H__
+
+    #define __COMMAND_H__
+
+    /* Project dependencies. */
+    #include "InterruptRoutines.h"
+    #include "LogUtils.h"
+    #include "Profiler.h"
+    #include "CRC.h"
+    #include "Transfer.h"
+
+    /* Useful constants definition. */
+    #define CMD_RX_BUFFER_SIZE      256 // Holds a restored page and its CRC
+    #define CMD_RX_BUFFER_MASK      (CMD_RX_BUFFER_SIZE - 1)
+    #define CMD_MAX_ARG_BYTE        8
+    #define CMD_ARG_TIMEOUT_MS      50  // Partial command is discarded after this time
+    
+    /* Log selection of the range download. */
+    #define CMD_RANGE_SPAN          0   // Logs from first ID up to last ID
+    #define CMD_RANGE_NEWER         1   // Logs newer than the given ID
+    #define CMD_RANGE_ARG_BYTE      3   // Selection, first ID, last ID
+    
+    /* Raw image of the EEPROM memory. */
+    #define CMD_IMAGE_SIZE          ((uint32_t)SPI_EEPROM_PAGE_COUNT * SPI_EEPROM_PAGE_SIZE)
+    #define CMD_IMAGE_ARG_BYTE      4   // Start address, length (0 for the whole memory)
+    #define CMD_IMAGE_BLOCK_BYTE    256 // Bytes of the dump covered by each CRC
+    #define CMD_IMAGE_TIMEOUT_MS    1000 // Restore is stopped if no page arrives
+    #define CMD_IMAGE_ABORT         0x41 // Sent when the restore is stopped
+
+    /* Long operations executed one step per loop iteration. */
+    typedef enum {
+        CMD_JOB_NONE,
+        CMD_JOB_RESET_MEMORY,
+        CMD_JOB_SEND_LOG,
+        CMD_JOB_SEND_LOG_RANGE,
+        CMD_JOB_DUMP_IMAGE,
+        CMD_JOB_RESTORE_IMAGE,
+        CMD_JOB_SEND_CATALOG,
+        CMD_JOB_SEND_STATISTICS
+    } cmd_job_t;
+
+    /* Function prototype declaration. */
+    void CMD_Init(void);
+    void CMD_pushByte(uint8_t dataByte);
+    void CMD_Process(void);
+
+#endif
+
+/* [] END OF FILE */
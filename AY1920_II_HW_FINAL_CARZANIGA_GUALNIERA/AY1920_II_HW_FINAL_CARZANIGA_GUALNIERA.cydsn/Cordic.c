@@ -0,0 +1,145 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the fixed-point CORDIC kernel.
+ *
+ * In vectoring mode the vector (x, y) is
+ * rotated toward the x axis by angles of
+ * atan(2^-i), using only shifts and additions:
+ *
+ *  x' = x + d * (y >> i)
+ *  y' = y - d * (x >> i)      d = sign(y)
+ *  z' = z + d * atan(2^-i)
+ *
+ * -> z converges to atan2(y, x).
+ *
+ * -> x converges to K * sqrt(x^2 + y^2),
+ *    where the gain K is removed with a
+ *    single Q16 multiplication.
+ *
+ * Angles are binary angles (65536 = 360 deg),
+ * so they wrap around for free in 16 bits.
+ * Tilt of a LIS3DH sample takes two runs:
+ *
+ *  roll  = atan2(Y, Z)
+ *  pitch = atan2(-X, sqrt(Y^2 + Z^2))
+ *
+ * and the second run also gives the magnitude
+ * of the whole acceleration vector.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Cordic.h"
+
+
+/* Rotation angles atan(2^-i) as binary angles. */
+static const int16_t cordic_atan_table[CORDIC_ITERATIONS] = {
+    8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1
+};
+
+
+/*******************************************************************************
+* Function Name: CORDIC_atan2
+********************************************************************************
+*
+* Summary:
+*   Compute angle and length of vector (x, y) with CORDIC vectoring mode.
+*
+* Parameters:  
+*   Vector coordinates (|x|, |y| < 2^29), pointer to magnitude (may be NULL).
+*
+* Return:
+*   Binary angle of atan2(y, x) (65536 = 360 deg).
+*
+*******************************************************************************/
+int16_t CORDIC_atan2(int32_t y, int32_t x, int32_t* magnitude)
+{
+    int32_t z = 0;
+    
+    // Rotate by 180 deg into the right half plane
+    if (x < 0)
+    {
+        x = -x;
+        y = -y;
+        z = CORDIC_ANGLE_180;
+    }
+    
+    // Rotate toward the x axis
+    for (uint8_t i=0; i<CORDIC_ITERATIONS; i++)
+    {
+        int32_t x_shift = x >> i;
+        int32_t y_shift = y >> i;
+        
+        if (y > 0)
+        {
+            x += y_shift;
+            y -= x_shift;
+            z += cordic_atan_table[i];
+        }
+        else
+        {
+            x -= y_shift;
+            y += x_shift;
+            z -= cordic_atan_table[i];
+        }
+    }
+    
+    // Remove CORDIC gain
+    if (magnitude != NULL)
+    {
+        *magnitude = (int32_t)(((int64_t)x * CORDIC_GAIN_INV) >> 16);
+    }
+    
+    return (int16_t)z;
+}
+
+
+/*******************************************************************************
+* Function Name: CORDIC_Orientation
+********************************************************************************
+*
+* Summary:
+*   Convert rows of 3 axis value X, Y, Z into rows of roll, pitch and magnitude.
+*   Angles are sent as 8-bit binary angles (256 = 360 deg, about 1.4 deg per
+*   LSB) and magnitude is in the same unit as the samples, saturated to 127, so
+*   that output rows are still signed 8-bit values.
+*
+* Parameters:  
+*   Input rows, number of rows, output rows (may be the same buffer).
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CORDIC_Orientation(uint8_t* rows, uint8_t nRows, uint8_t* output)
+{
+    uint32_t start = PROF_start();
+    
+    for (uint8_t i=0; i<nRows; i++)
+    {
+        int32_t x = (int32_t)(int8_t)rows[i*3] << CORDIC_INPUT_SHIFT;
+        int32_t y = (int32_t)(int8_t)rows[i*3 + 1] << CORDIC_INPUT_SHIFT;
+        int32_t z = (int32_t)(int8_t)rows[i*3 + 2] << CORDIC_INPUT_SHIFT;
+        
+        // Roll around X axis and length of the YZ projection
+        int32_t yz_magnitude;
+        int16_t roll = CORDIC_atan2(y, z, &yz_magnitude);
+        
+        // Pitch around Y axis and length of the whole vector
+        int32_t magnitude;
+        int16_t pitch = CORDIC_atan2(-x, yz_magnitude, &magnitude);
+        
+        // Round to 8-bit values
+        magnitude = (magnitude + (1 << (CORDIC_INPUT_SHIFT - 1))) >> CORDIC_INPUT_SHIFT;
+        output[i*3] = (uint8_t)((roll + 0x80) >> 8);
+        output[i*3 + 1] = (uint8_t)((pitch + 0x80) >> 8);
+        output[i*3 + 2] = (magnitude > INT8_MAX) ? INT8_MAX : (uint8_t)magnitude;
+    }
+    
+    PROF_stop(PROF_CORDIC, start);
+}
+
+/* [] END OF FILE */
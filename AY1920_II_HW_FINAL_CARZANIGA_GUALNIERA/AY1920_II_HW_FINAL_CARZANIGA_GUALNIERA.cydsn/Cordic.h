@@ -0,0 +1,34 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the fixed-point
+ * CORDIC kernel used to compute tilt angles
+ * and magnitude of the acceleration vector.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __CORDIC_H__
+    
+    #define __CORDIC_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "Profiler.h"
+    
+    /* Useful constants definition. */
+    #define CORDIC_ITERATIONS   14
+    #define CORDIC_INPUT_SHIFT  8       // Fractional bits added to int8 samples
+    #define CORDIC_GAIN_INV     39797   // 1/K in Q16 (K = 1.6468)
+    #define CORDIC_ANGLE_180    32768   // Binary angle: 65536 = 360 deg
+    #define CORDIC_ANGLE_90     16384
+    
+    /* Function prototype declaration. */
+    int16_t CORDIC_atan2(int32_t y, int32_t x, int32_t* magnitude);
+    void CORDIC_Orientation(uint8_t* rows, uint8_t nRows, uint8_t* output);
+    
+#endif
+
+/* [] END OF FILE */
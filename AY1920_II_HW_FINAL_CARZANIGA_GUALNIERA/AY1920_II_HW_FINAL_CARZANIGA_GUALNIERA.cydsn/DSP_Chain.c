@@ -0,0 +1,400 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the chain of fixed-point filters that
+ * processes each new FIFO of IMU data:
+ *
+ *  raw -> [median] -> [high-pass] -> [low-pass]
+ *      -> [average] -> [envelope] -> output
+ *
+ * -> Median: 3 samples median, rejects single
+ *    sample spikes.
+ *
+ * -> High-pass: removes the gravity estimated
+ *    by a slow exponential moving average.
+ *
+ * -> Low-pass: exponential moving average.
+ *
+ * -> Average: running sum over a window of 32
+ *    samples (the former LED box average).
+ *
+ * -> Envelope: absolute value with peak hold
+ *    and exponential decay.
+ *
+ * Each stage can be enabled at runtime and is
+ * applied to the whole frame (32 samples) at
+ * once, so that its cost per FIFO is measured
+ * separately by the profiler. Filter states
+ * use Q8 fixed-point values in 32-bit signed
+ * registers, and only additions and shifts,
+ * since the Cortex-M3 has no FPU.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "DSP_Chain.h"
+
+
+/* Selected stages and stages requested for the next frame. */
+static uint8_t dsp_stages;
+static volatile uint8_t dsp_pending_stages;
+
+/* Working frame. */
+static int16_t dsp_frame[DSP_FRAME_SAMPLES][3];
+
+/* Stage states. */
+static int16_t dsp_median_history[2][3];
+static int32_t dsp_gravity[3];
+static int32_t dsp_lowpass[3];
+static int16_t dsp_average_window[DSP_AVERAGE_WINDOW][3];
+static int16_t dsp_average_sum[3];
+static uint8_t dsp_average_index;
+static int32_t dsp_envelope[3];
+
+
+/*******************************************************************************
+* Function Name: DSP_resetStates
+********************************************************************************
+*
+* Summary:
+*   Reset the state of all filter stages.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void DSP_resetStates(void)
+{
+    memset(dsp_median_history, 0, sizeof(dsp_median_history));
+    memset(dsp_gravity, 0, sizeof(dsp_gravity));
+    memset(dsp_lowpass, 0, sizeof(dsp_lowpass));
+    memset(dsp_average_window, 0, sizeof(dsp_average_window));
+    memset(dsp_average_sum, 0, sizeof(dsp_average_sum));
+    dsp_average_index = 0;
+    memset(dsp_envelope, 0, sizeof(dsp_envelope));
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_Init
+********************************************************************************
+*
+* Summary:
+*   Select the default filter stages and reset their state.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void DSP_Init(void)
+{
+    dsp_stages = DSP_STAGE_DEFAULT;
+    dsp_pending_stages = DSP_STAGE_DEFAULT;
+    DSP_resetStates();
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_setStages
+********************************************************************************
+*
+* Summary:
+*   Request a new selection of filter stages, applied from the next frame so
+*   that it can be safely called from an ISR.
+*
+* Parameters:  
+*   Mask of filter stages.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void DSP_setStages(uint8_t stages)
+{
+    dsp_pending_stages = stages & DSP_STAGE_ALL;
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_getStages
+********************************************************************************
+*
+* Summary:
+*   Get the selection of filter stages.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Mask of filter stages.
+*
+*******************************************************************************/
+uint8_t DSP_getStages(void)
+{
+    return dsp_pending_stages;
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_median
+********************************************************************************
+*
+* Summary:
+*   Replace each sample with the median of itself and the two previous ones.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void DSP_median(void)
+{
+    for (uint8_t i=0; i<DSP_FRAME_SAMPLES; i++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            int16_t a = dsp_median_history[0][axis];
+            int16_t b = dsp_median_history[1][axis];
+            int16_t c = dsp_frame[i][axis];
+            
+            // Shift history
+            dsp_median_history[0][axis] = b;
+            dsp_median_history[1][axis] = c;
+            
+            // Median of 3 values
+            int16_t lo = (a < b) ? a : b;
+            int16_t hi = (a < b) ? b : a;
+            dsp_frame[i][axis] = (c < lo) ? lo : ((c > hi) ? hi : c);
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_highpass
+********************************************************************************
+*
+* Summary:
+*   Subtract the gravity, estimated with a slow moving average, from each
+*   sample.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void DSP_highpass(void)
+{
+    for (uint8_t i=0; i<DSP_FRAME_SAMPLES; i++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            // Update gravity estimate (Q8)
+            int32_t x = (int32_t)dsp_frame[i][axis] << 8;
+            dsp_gravity[axis] += (x - dsp_gravity[axis]) >> DSP_HIGHPASS_SHIFT;
+            
+            // Remove gravity
+            dsp_frame[i][axis] = (int16_t)((x - dsp_gravity[axis]) >> 8);
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_lowpass
+********************************************************************************
+*
+* Summary:
+*   Filter each sample with an exponential moving average.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void DSP_lowpass(void)
+{
+    for (uint8_t i=0; i<DSP_FRAME_SAMPLES; i++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            // Update filter state (Q8)
+            int32_t x = (int32_t)dsp_frame[i][axis] << 8;
+            dsp_lowpass[axis] += (x - dsp_lowpass[axis]) >> DSP_LOWPASS_SHIFT;
+            
+            dsp_frame[i][axis] = (int16_t)(dsp_lowpass[axis] >> 8);
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_average
+********************************************************************************
+*
+* Summary:
+*   Replace each sample with the average of the last DSP_AVERAGE_WINDOW samples,
+*   updating a running sum with the new sample and the oldest one only. Samples
+*   are kept at 16 bits, the sum of a full window of high-pass output
+*   (32 x 255) still fits the running sum.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void DSP_average(void)
+{
+    for (uint8_t i=0; i<DSP_FRAME_SAMPLES; i++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            // Replace the oldest sample of the window (high-pass output needs 9 bits)
+            int16_t x = dsp_frame[i][axis];
+            dsp_average_sum[axis] += x - dsp_average_window[dsp_average_index][axis];
+            dsp_average_window[dsp_average_index][axis] = x;
+            
+            dsp_frame[i][axis] = dsp_average_sum[axis] / DSP_AVERAGE_WINDOW;
+        }
+        dsp_average_index = (dsp_average_index + 1) % DSP_AVERAGE_WINDOW;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_envelope
+********************************************************************************
+*
+* Summary:
+*   Replace each sample with the envelope of its absolute value: rising edges
+*   are followed immediately, falling edges decay exponentially.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void DSP_envelope(void)
+{
+    for (uint8_t i=0; i<DSP_FRAME_SAMPLES; i++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            // Absolute value (Q8)
+            int32_t x = dsp_frame[i][axis];
+            x = ((x < 0) ? -x : x) << 8;
+            
+            // Peak hold with decay
+            if (x > dsp_envelope[axis])
+            {
+                dsp_envelope[axis] = x;
+            }
+            else
+            {
+                dsp_envelope[axis] -= dsp_envelope[axis] >> DSP_ENVELOPE_SHIFT;
+            }
+            
+            dsp_frame[i][axis] = (int16_t)(dsp_envelope[axis] >> 8);
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: DSP_Process
+********************************************************************************
+*
+* Summary:
+*   Apply the selected filter stages to a new FIFO of IMU data, measuring the
+*   cycles spent by each stage.
+*
+* Parameters:  
+*   Raw FIFO data pointer (32 levels of 6 bytes), output buffer (32 rows of 3
+*   axis value X, Y, Z).
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void DSP_Process(uint8_t* rawData, uint8_t* output)
+{
+    // Apply new stage selection with clean states
+    if (dsp_pending_stages != dsp_stages)
+    {
+        dsp_stages = dsp_pending_stages;
+        DSP_resetStates();
+    }
+    
+    // Load high registers of the FIFO
+    for (uint8_t i=0; i<DSP_FRAME_SAMPLES; i++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            dsp_frame[i][axis] = (int8_t)rawData[i*LIS3DH_FIFO_BYTES_IN_LEVEL + axis*2 + 1];
+        }
+    }
+    
+    // Run selected stages
+    uint32_t start;
+    if (dsp_stages & DSP_STAGE_MEDIAN)
+    {
+        start = PROF_start();
+        DSP_median();
+        PROF_stop(PROF_DSP_MEDIAN, start);
+    }
+    if (dsp_stages & DSP_STAGE_HIGHPASS)
+    {
+        start = PROF_start();
+        DSP_highpass();
+        PROF_stop(PROF_DSP_HIGHPASS, start);
+    }
+    if (dsp_stages & DSP_STAGE_LOWPASS)
+    {
+        start = PROF_start();
+        DSP_lowpass();
+        PROF_stop(PROF_DSP_LOWPASS, start);
+    }
+    if (dsp_stages & DSP_STAGE_AVERAGE)
+    {
+        start = PROF_start();
+        DSP_average();
+        PROF_stop(PROF_DSP_AVERAGE, start);
+    }
+    if (dsp_stages & DSP_STAGE_ENVELOPE)
+    {
+        start = PROF_start();
+        DSP_envelope();
+        PROF_stop(PROF_DSP_ENVELOPE, start);
+    }
+    
+    // Saturate output to 8 bits
+    for (uint8_t i=0; i<DSP_FRAME_SAMPLES; i++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            int16_t y = dsp_frame[i][axis];
+            y = (y > INT8_MAX) ? INT8_MAX : ((y < INT8_MIN) ? INT8_MIN : y);
+            output[i*3 + axis] = (uint8_t)(int8_t)y;
+        }
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,51 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the chain of
+ * fixed-point filters applied to each new
+ * FIFO of IMU data before it drives the
+ * RGB LED and the UART stream.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __DSP_CHAIN_H__
+    
+    #define __DSP_CHAIN_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "LIS3DH.h"
+    #include "Profiler.h"
+    
+    /* Useful constants definition. */
+    #define DSP_FRAME_SAMPLES   LIS3DH_LEVELS_IN_FIFO
+    #define DSP_FRAME_BYTES     (DSP_FRAME_SAMPLES * 3)
+    #define DSP_AVERAGE_WINDOW  32
+    #define DSP_HIGHPASS_SHIFT  8   // Gravity estimate time constant: 256 samples (1.28 s)
+    #define DSP_LOWPASS_SHIFT   2   // Low-pass time constant: 4 samples (20 ms)
+    #define DSP_ENVELOPE_SHIFT  5   // Envelope decay time constant: 32 samples (160 ms)
+    
+    /* Filter stages, applied in this order when selected. */
+    #define DSP_STAGE_MEDIAN    0x01
+    #define DSP_STAGE_HIGHPASS  0x02
+    #define DSP_STAGE_LOWPASS   0x04
+    #define DSP_STAGE_AVERAGE   0x08
+    #define DSP_STAGE_ENVELOPE  0x10
+    #define DSP_STAGE_ALL       0x1F
+    #define DSP_STAGE_DEFAULT   (DSP_STAGE_HIGHPASS | DSP_STAGE_AVERAGE)
+    
+    /* Filtered FIFO (rows of 3 axis value X, Y, Z). */
+    uint8_t DSP_DataBuffer[DSP_FRAME_BYTES];
+    
+    /* Function prototype declaration. */
+    void DSP_Init(void);
+    void DSP_setStages(uint8_t stages);
+    uint8_t DSP_getStages(void);
+    void DSP_Process(uint8_t* rawData, uint8_t* output);
+    
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,140 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the fixed-point anti-aliasing decimator.
+ *
+ * Each axis is filtered by a 3rd order CIC
+ * (cascaded integrator-comb) decimator:
+ *
+ *  x -> [I] -> [I] -> [I] -> |R -> [C] -> [C] -> [C] -> y
+ *
+ * -> Integrators run at the input rate,
+ *    y[n] = y[n-1] + x[n]
+ *
+ * -> Combs run at the output rate (one every
+ *    R input samples), y[m] = x[m] - x[m-1]
+ *
+ * The filter only needs additions, which is
+ * well suited to the Cortex-M3 without FPU,
+ * and it has zeros on every multiple of the
+ * output rate, where the aliased components
+ * would fold onto the stored band. Registers
+ * use 32-bit modular arithmetic, so integrator
+ * wrap-around is cancelled by the combs, and
+ * the DC gain R^3 (a power of 2 for R = 2, 4,
+ * 8) is removed with a shift. The group delay
+ * is 3*(R-1)/2 input samples.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Decimator.h"
+
+
+/*******************************************************************************
+* Function Name: DECIM_Init
+********************************************************************************
+*
+* Summary:
+*   Reset the decimator state and set its decimation ratio.
+*
+* Parameters:  
+*   Decimator pointer, decimation ratio (1, 2, 4 or 8).
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void DECIM_Init(decim_t* decim, uint8_t ratio)
+{
+    memset(decim, 0, sizeof(decim_t));
+    
+    // Clip to supported ratios
+    if (ratio > DECIM_MAX_RATIO)
+    {
+        ratio = DECIM_MAX_RATIO;
+    }
+    if (ratio == 0)
+    {
+        ratio = 1;
+    }
+    decim->ratio = ratio;
+    
+    // Gain R^ORDER is removed with ORDER*log2(R) shifts
+    for (uint8_t r = ratio; r > 1; r >>= 1)
+    {
+        decim->shift += DECIM_ORDER;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: DECIM_Process
+********************************************************************************
+*
+* Summary:
+*   Filter and decimate rows of 3 axis value X, Y, Z (8-bit signed). The filter
+*   state is kept between calls, so consecutive FIFO are processed as a single
+*   continuous stream.
+*
+* Parameters:  
+*   Decimator pointer, input rows, number of input rows, output rows.
+*
+* Return:
+*   Number of bytes written in the output buffer.
+*
+*******************************************************************************/
+uint8_t DECIM_Process(decim_t* decim, uint8_t* rowsIn, uint8_t nRows, uint8_t* rowsOut)
+{
+    uint8_t n_bytes = 0;
+    
+    for (uint8_t row = 0; row < nRows; row++)
+    {
+        // Integrator stages at input rate
+        for (uint8_t axis = 0; axis < DECIM_AXES; axis++)
+        {
+            uint32_t* integrator = decim->integrator[axis];
+            integrator[0] += (uint32_t)(int32_t)(int8_t)rowsIn[row*DECIM_AXES + axis];
+            integrator[1] += integrator[0];
+            integrator[2] += integrator[1];
+        }
+        
+        // Output one row every ratio input rows
+        if (++decim->phase < decim->ratio)
+        {
+            continue;
+        }
+        decim->phase = 0;
+        
+        // Comb stages at output rate
+        for (uint8_t axis = 0; axis < DECIM_AXES; axis++)
+        {
+            uint32_t* comb = decim->comb[axis];
+            uint32_t value = decim->integrator[axis][2];
+            for (uint8_t stage = 0; stage < DECIM_ORDER; stage++)
+            {
+                uint32_t delayed = comb[stage];
+                comb[stage] = value;
+                value -= delayed;
+            }
+            
+            // Remove filter gain and saturate to 8 bits
+            int32_t output = (int32_t)value >> decim->shift;
+            if (output > INT8_MAX)
+            {
+                output = INT8_MAX;
+            }
+            else if (output < INT8_MIN)
+            {
+                output = INT8_MIN;
+            }
+            rowsOut[n_bytes++] = (uint8_t)(int8_t)output;
+        }
+    }
+    
+    return n_bytes;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,40 @@
+/* ========================================
+ *
+ * This header file contains constants,
+ * data types and function prototypes of the
+ * fixed-point decimator used to down sample
+ * IMU data before it is logged.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __DECIMATOR_H__
+    
+    #define __DECIMATOR_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    
+    /* Useful constants definition. */
+    #define DECIM_ORDER     3
+    #define DECIM_AXES      3
+    #define DECIM_MAX_RATIO 8
+    
+    /* Decimator state (one CIC filter per axis). */
+    typedef struct {
+        uint8_t ratio;
+        uint8_t shift;
+        uint8_t phase;
+        uint32_t integrator[DECIM_AXES][DECIM_ORDER];
+        uint32_t comb[DECIM_AXES][DECIM_ORDER];
+    } decim_t;
+    
+    /* Function prototype declaration. */
+    void DECIM_Init(decim_t* decim, uint8_t ratio);
+    uint8_t DECIM_Process(decim_t* decim, uint8_t* rowsIn, uint8_t nRows, uint8_t* rowsOut);
+    
+#endif
+
+/* [] END OF FILE */
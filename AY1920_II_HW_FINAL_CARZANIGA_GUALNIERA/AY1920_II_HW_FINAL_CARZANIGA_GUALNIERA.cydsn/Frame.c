@@ -0,0 +1,260 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the framed UART stream.
+ *
+ * Instead of wrapping every sample inside a
+ * 0xA0 header and a 0xC0 tail (40% of the
+ * bytes), a whole FIFO is sent as one frame:
+ *
+ * +--------------------+
+ * |   Sync 0x5A 0xA5   |   <2 bytes>
+ * +--------------------+
+ * |     Frame type     |   <1 byte>
+ * +--------------------+
+ * |  Sequence number   |   <2 bytes>
+ * +--------------------+
+ * |   Timestamp [ms]   |   <4 bytes>
+ * +--------------------+
+ * |    Sample count    |   <1 byte>
+ * +--------------------+
+ * |                    |
+ * |      Samples       |   <count * 3 or count * 6 bytes>
+ * |                    |
+ * +--------------------+
+ * |       CRC-16       |   <2 bytes>
+ * +--------------------+
+ *
+ * Frame type: content of the stream (low
+ *             nibble, same as stream_t),
+ *             sample width (bit 4 set for
+ *             16-bit samples) and coding
+ *             (bit 5 set for samples
+ *             compressed by the codec)
+ *
+ * Sequence number: incremented at every frame,
+ *                  also when the frame is
+ *                  dropped by the TX ring
+ *                  buffer, so that the host
+ *                  detects lost frames
+ *
+ * Timestamp: ms from boot when the frame
+ *            is built
+ *
+ * Samples: rows of X, Y, Z values, as signed
+ *          8-bit values or as 16-bit left
+ *          justified raw FIFO values (little
+ *          endian), or the length of the
+ *          codec output of the 8-bit rows
+ *          (1 byte) followed by the codec
+ *          output itself. Frames are sent
+ *          uncompressed when the codec does
+ *          not save any byte
+ *
+ * CRC-16: CRC-16/CCITT-FALSE of all bytes
+ *         from frame type to the last sample
+ *         (little endian)
+ *
+ * All fields are little endian. A FIFO of 32
+ * samples takes 108 bytes instead of 160.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Frame.h"
+
+
+/* Stream format and frame counter. */
+static uint8_t frame_format;
+static uint16_t frame_seq;
+
+/* Frame under construction. */
+static uint8_t frame_buffer[FRAME_MAX_BYTE];
+
+
+/*******************************************************************************
+* Function Name: FRAME_Init
+********************************************************************************
+*
+* Summary:
+*   Select the default stream format and reset the frame counter.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void FRAME_Init(void)
+{
+    frame_format = FRAME_DEFAULT_FORMAT;
+    frame_seq = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: FRAME_setFormat
+********************************************************************************
+*
+* Summary:
+*   Select the stream format, invalid formats are ignored.
+*
+* Parameters:  
+*   Stream format.
+*
+* Return:
+*   Stream format applied.
+*
+*******************************************************************************/
+uint8_t FRAME_setFormat(uint8_t format)
+{
+    if (format < FRAME_FORMATS)
+    {
+        frame_format = format;
+    }
+    
+    return frame_format;
+}
+
+
+/*******************************************************************************
+* Function Name: FRAME_getFormat
+********************************************************************************
+*
+* Summary:
+*   Get the stream format.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Stream format.
+*
+*******************************************************************************/
+uint8_t FRAME_getFormat(void)
+{
+    return frame_format;
+}
+
+
+/*******************************************************************************
+* Function Name: FRAME_send
+********************************************************************************
+*
+* Summary:
+*   Build a frame around the given samples and queue it as a whole inside the
+*   TX ring buffer.
+*
+* Parameters:  
+*   Frame type, samples pointer, number of sample bytes, number of rows.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void FRAME_send(uint8_t type, uint8_t* samples, uint16_t nBytes, uint8_t nRows)
+{
+    uint32_t time = LOG_TIMER_OVERFLOW - MAIN_TIMER_ReadCounter();
+    
+    // Fill up header
+    frame_buffer[0] = FRAME_SYNC_0;
+    frame_buffer[1] = FRAME_SYNC_1;
+    frame_buffer[FRAME_HDR_TYPE] = type;
+    frame_buffer[FRAME_HDR_SEQ_LOW] = frame_seq & 0xFF;
+    frame_buffer[FRAME_HDR_SEQ_HIGH] = (frame_seq >> 8) & 0xFF;
+    for (uint8_t i=0; i<4; i++)
+    {
+        frame_buffer[FRAME_HDR_TIME + i] = (time >> (8 * i)) & 0xFF;
+    }
+    frame_buffer[FRAME_HDR_ROWS] = nRows;
+    frame_seq++;
+    
+    // Copy samples and append CRC of everything after the sync word
+    memcpy(&frame_buffer[FRAME_HEADER_BYTE], samples, nBytes);
+    uint16_t length = FRAME_HEADER_BYTE + nBytes;
+    uint16_t crc = CRC_update(CRC_INIT, &frame_buffer[FRAME_HDR_TYPE], length - FRAME_HDR_TYPE);
+    frame_buffer[length++] = crc & 0xFF;
+    frame_buffer[length++] = (crc >> 8) & 0xFF;
+    
+    SERIAL_PutArray(SERIAL_CHANNEL_STREAM, frame_buffer, length);
+}
+
+
+/*******************************************************************************
+* Function Name: FRAME_sendRows
+********************************************************************************
+*
+* Summary:
+*   Send rows of 8-bit X, Y, Z values in the selected stream format. The legacy
+*   format sends one A0 X Y Z C0 packet per row, or a single A1 ... C0 packet
+*   for band amplitudes. The compressed format falls back to plain rows when
+*   the codec output is not shorter.
+*
+* Parameters:  
+*   Stream content, rows pointer, number of rows.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void FRAME_sendRows(uint8_t content, uint8_t* rows, uint8_t nRows)
+{
+    if ((frame_format == FRAME_FORMAT_RICE) && (nRows > 1))
+    {
+        // Compressed rows, preceded by their length, only if shorter than plain ones
+        uint8_t coded[FRAME_MAX_PAYLOAD_BYTE];
+        uint16_t n_bytes = CODEC_encode(rows, nRows, &coded[1], nRows * 3 - 2);
+        if (n_bytes > 0)
+        {
+            coded[0] = n_bytes;
+            FRAME_send(content | FRAME_TYPE_RICE, coded, n_bytes + 1, nRows);
+            return;
+        }
+    }
+    
+    if (frame_format != FRAME_FORMAT_LEGACY)
+    {
+        FRAME_send(content, rows, nRows * 3, nRows);
+        return;
+    }
+    
+    if (content == FRAME_CONTENT_SPECTRUM)
+    {
+        // Header, X, Y, Z amplitudes of each band, tail
+        uint8_t packet[SPEC_FRAME_BYTES + 2];
+        packet[0] = SPEC_STREAM_HEADER;
+        memcpy(&packet[1], rows, SPEC_FRAME_BYTES);
+        packet[SPEC_FRAME_BYTES + 1] = SPEC_STREAM_TAIL;
+        SERIAL_PutArray(SERIAL_CHANNEL_STREAM, packet, SPEC_FRAME_BYTES + 2);
+    }
+    else
+    {
+        IMU_DataSend(rows);
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: FRAME_sendWide
+********************************************************************************
+*
+* Summary:
+*   Send a frame of 16-bit samples taken as they are from a raw FIFO (low and
+*   high register of X, Y, Z for each level).
+*
+* Parameters:  
+*   Stream content, raw FIFO pointer, number of levels.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void FRAME_sendWide(uint8_t content, uint8_t* rawData, uint8_t nRows)
+{
+    FRAME_send(content | FRAME_TYPE_WIDE, rawData, nRows * LIS3DH_FIFO_BYTES_IN_LEVEL, nRows);
+}
+
+/* [] END OF FILE */
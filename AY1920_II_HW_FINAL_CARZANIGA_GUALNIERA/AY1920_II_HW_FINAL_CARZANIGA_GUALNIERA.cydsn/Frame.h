@@ -0,0 +1,63 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the framed UART
+ * stream, carrying one FIFO per frame with
+ * sequence number, timestamp and CRC.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __FRAME_H__
+    
+    #define __FRAME_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "LIS3DH.h"
+    #include "LogUtils.h"
+    #include "Spectrum.h"
+    #include "Serial.h"
+    #include "CRC.h"
+    #include "Codec.h"
+    
+    /* Stream formats. */
+    #define FRAME_FORMAT_LEGACY     0   // A0 X Y Z C0 per sample (Bridge Control Panel)
+    #define FRAME_FORMAT_PACKED     1   // One frame per FIFO, 8-bit samples
+    #define FRAME_FORMAT_WIDE       2   // One frame per FIFO, 16-bit raw samples
+    #define FRAME_FORMAT_RICE       3   // One frame per FIFO, 8-bit samples compressed by the codec
+    #define FRAME_FORMATS           4
+    #define FRAME_DEFAULT_FORMAT    FRAME_FORMAT_PACKED
+    
+    /* Frame content (same order as stream_t). */
+    #define FRAME_CONTENT_XYZ       0
+    #define FRAME_CONTENT_ORIENTATION 1
+    #define FRAME_CONTENT_SPECTRUM  2
+    #define FRAME_TYPE_WIDE         0x10
+    #define FRAME_TYPE_RICE         0x20
+    
+    /* Frame layout. */
+    #define FRAME_SYNC_0            0x5A
+    #define FRAME_SYNC_1            0xA5
+    #define FRAME_HEADER_BYTE       10
+    #define FRAME_CRC_BYTE          2
+    #define FRAME_HDR_TYPE          2
+    #define FRAME_HDR_SEQ_LOW       3
+    #define FRAME_HDR_SEQ_HIGH      4
+    #define FRAME_HDR_TIME          5
+    #define FRAME_HDR_ROWS          9
+    #define FRAME_MAX_PAYLOAD_BYTE  (LIS3DH_LEVELS_IN_FIFO * 6)
+    #define FRAME_MAX_BYTE          (FRAME_HEADER_BYTE + FRAME_MAX_PAYLOAD_BYTE + FRAME_CRC_BYTE)
+    
+    /* Function prototype declaration. */
+    void FRAME_Init(void);
+    uint8_t FRAME_setFormat(uint8_t format);
+    uint8_t FRAME_getFormat(void);
+    void FRAME_sendRows(uint8_t content, uint8_t* rows, uint8_t nRows);
+    void FRAME_sendWide(uint8_t content, uint8_t* rawData, uint8_t nRows);
+    
+#endif
+
+/* [] END OF FILE */
@@ -18,6 +18,13 @@
     #include "25LC256.h"
     #include "LIS3DH.h"
     #include "Notifications.h"
+    #include "LogQueue.h"
+    #include "LogCatalog.h"
+    #include "DSP_Chain.h"
+    #include "Trigger.h"
+    #include "Statistics.h"
+    #include "Serial.h"
+    #include "Frame.h"
     
     /* Remote UART Instruction Set. */
     #define UART_RX_OPERATION_ACK   0x4B
@@ -25,6 +32,19 @@
     #define UART_RX_NUMBER_OF_LOGS  0x4E
     #define UART_RX_READ_CTRL_REG   0x43
     #define UART_RX_SEND_LOG_ID     0x4C
+    #define UART_RX_QUEUE_STATUS    0x51
+    #define UART_RX_SEND_CATALOG    0x49
+    #define UART_RX_SEND_PROFILE    0x50
+    #define UART_RX_SET_DSP_STAGES  0x44
+    #define UART_RX_SET_STREAM_MODE 0x4F
+    #define UART_RX_SET_TRIGGER     0x54
+    #define UART_RX_SEND_STATISTICS 0x53
+    #define UART_RX_SERIAL_STATUS   0x55
+    #define UART_RX_SET_STREAM_FORMAT 0x46
+    #define UART_RX_SEND_LOG_RANGE  0x42
+    #define UART_RX_DUMP_IMAGE      0x45
+    #define UART_RX_RESTORE_IMAGE   0x57
+    #define UART_RX_SET_LINK_MODE   0x58
     
     /* State machine type. */
     typedef enum {
@@ -32,20 +52,37 @@
         START_MODE,
         CONFIG_MODE
     } button_t;
+    
+    /* UART stream content. */
+    typedef enum {
+        STREAM_XYZ,
+        STREAM_ORIENTATION,
+        STREAM_SPECTRUM,
+        STREAM_MODES
+    } stream_t;
 
     /* LIS3DH interrupt flags. */
     volatile uint8_t IMU_data_ready_flag;
     volatile uint8_t IMU_over_threshold_flag;
     
+    /* FIFO level when the over threshold event occurred. */
+    volatile uint8_t IMU_trigger_level;
+    
+    /* Button event flags. */
+    volatile uint8_t button_config_flag;
+    volatile uint8_t button_start_flag;
+    
     /* Internal state variable. */
     volatile button_t button_state;
     volatile uint8_t send_flag;
+    volatile stream_t stream_mode;
     
     /* ISR functions prototype declaration. */
     CY_ISR_PROTO(CUSTOM_ISR_CONFIG);
     CY_ISR_PROTO(CUSTOM_ISR_START);
     CY_ISR_PROTO(CUSTOM_ISR_IMU);
     CY_ISR_PROTO(CUSTOM_ISR_RX);
+    CY_ISR_PROTO(CUSTOM_ISR_TX);
     
 #endif
 
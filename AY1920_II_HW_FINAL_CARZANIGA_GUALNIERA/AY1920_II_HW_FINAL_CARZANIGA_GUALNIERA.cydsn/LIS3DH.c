@@ -12,6 +12,10 @@
 #include "LIS3DH.h"
 
 
+/* Anti-aliasing decimator of logged data. */
+static decim_t imu_decimator;
+
+
 /*******************************************************************************
 * Function Name: IMU_ReadByte
 ********************************************************************************
@@ -56,6 +60,9 @@ void IMU_Init(void)
     // Reset all registers before setup
     IMU_Setup();
     
+    // Reset decimator of logged data
+    DECIM_Init(&imu_decimator, LIS3DH_DOWN_SAMPLE);
+    
     // Disable IMU data acquisition and transmission
     IMU_Stop();
 }
@@ -207,7 +214,7 @@ void IMU_Start(void)
     
     // Setup FIFO control register
     BUFFTX[0] = LIS3DH_FIFO_CTRL_REG;
-    BUFFTX[1] = LIS3DH_FIFO_CTRL_REG_FIFO_MODE;
+    BUFFTX[1] = LIS3DH_FIFO_CTRL_REG_RUN_MODE;
 	SPI_IMU_Interface_Multi_RW(BUFFTX, 2, &temp, 0);
     
     // Setup interrupt 1 configuration register
@@ -244,15 +251,48 @@ void IMU_ReadFIFO(uint8_t *buffer)
 }
 
 
+/*******************************************************************************
+* Function Name: IMU_decimateFIFO
+********************************************************************************
+*
+* Summary:
+*   Extract high registers of one every downSample levels of a raw FIFO (32 
+*   levels of 6 bytes), giving rows of 3 axis value X, Y, Z.
+*
+* Parameters:  
+*   buffer: array to be filled with 32/downSample rows of IMU data
+*   rawData: array with raw data from IMU
+*   downSample: decimation factor (1 keeps the full data rate)
+*
+* Return:
+*   Number of bytes written in the buffer.
+*
+*******************************************************************************/
+uint8_t IMU_decimateFIFO(uint8_t *buffer, uint8_t *rawData, uint8_t downSample)
+{
+    uint8_t n_bytes = 0;
+    
+    // Keep only high registers of the selected levels
+    for(uint8_t level = 0; level < LIS3DH_LEVELS_IN_FIFO; level += downSample)
+    {
+        buffer[n_bytes++] = rawData[level*LIS3DH_FIFO_BYTES_IN_LEVEL + 1];
+        buffer[n_bytes++] = rawData[level*LIS3DH_FIFO_BYTES_IN_LEVEL + 3];
+        buffer[n_bytes++] = rawData[level*LIS3DH_FIFO_BYTES_IN_LEVEL + 5];
+    }
+    
+    return n_bytes;
+}
+
+
 /*******************************************************************************
 * Function Name: IMU_StoreFIFO
 ********************************************************************************
 *
 * Summary:
 *   Store the last read FIFO in a local queue that contains 6 FIFO at time.
-*   The new incoming FIFO is inserted in the first position of this queue and
-*   consequently the others FIFO are shifted by one position downward.
-*   This queue allows to ensure a constant number of samplesto be stored in the EEPROM.
+*   The queue is kept in chronological order: the others FIFO are shifted by one
+*   position toward the head (dropping the oldest one) and the new incoming FIFO
+*   is inserted in the last position of this queue.
 *
 * Parameters:  
 *   buffer: array with raw data from IMU
@@ -263,70 +303,56 @@ void IMU_ReadFIFO(uint8_t *buffer)
 *******************************************************************************/
 void IMU_StoreFIFO(uint8_t *buffer)
 {
-    // Buffer storing only high registers read from the IMU (8 bit configuration, low power mode)
+    // Save only high registers (8 bit configuration, low power mode)
     uint8_t high_reg_data[LIS3DH_BYTES_IN_FIFO_HIGH_REG];
-    uint8_t down_sampled_data[(LIS3DH_BYTES_IN_FIFO_HIGH_REG/LIS3DH_DOWN_SAMPLE)];
+    IMU_decimateFIFO(high_reg_data, buffer, 1);
     
-    // Save only the high registers 
-    for(uint8_t i = 0; i < LIS3DH_BYTES_IN_FIFO_HIGH_REG; i++)
-    {
-        high_reg_data[i] = buffer[i*2 +1];
-    }
-    
-    // Downsample from 96 values to 48 (from 32 levels of FIFO to 16 levels)
-    for(uint8_t i = 0; i < (LIS3DH_LEVELS_IN_FIFO/LIS3DH_DOWN_SAMPLE); i++)
-    {
-        down_sampled_data[i*3] = high_reg_data[(i*3)*2];
-        down_sampled_data[i*3 + 1] = high_reg_data[(i*3)*2 + 1];
-        down_sampled_data[i*3 + 2] = high_reg_data[(i*3)*2 + 2];
-    }
+    // Filter and downsample from 32 levels of FIFO to 32/DOWN_SAMPLE levels
+    uint8_t down_sampled_data[LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED];
+    uint32_t start = PROF_start();
+    DECIM_Process(&imu_decimator, high_reg_data, LIS3DH_LEVELS_IN_FIFO, down_sampled_data);
+    PROF_stop(PROF_DECIMATOR, start);
 
-    // Copy the first 5 FIFO in the next positions of the buffer, in order to free the first position to the new incoming FIFO
-    memcpy(&IMU_log_queue[LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED], IMU_log_queue, (LIS3DH_BYTES_IN_LOG_BUFFER - LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED));
-    
+    // Shift the last 5 FIFO toward the head of the queue, in order to free the last position to the new incoming FIFO
+    memmove(IMU_log_queue, &IMU_log_queue[LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED], (LIS3DH_BYTES_IN_LOG_BUFFER - LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED));
     
-    // Copy the new FIFO in the first place of the buffer
-    memcpy(&IMU_log_queue, down_sampled_data, LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED);
-
-
+    // Copy the new FIFO in the last place of the queue
+    memcpy(&IMU_log_queue[LIS3DH_BYTES_IN_LOG_BUFFER - LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED], down_sampled_data, LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED);
 }
 
 
 /*******************************************************************************
-* Function Name: IMU_getPayload
+* Function Name: IMU_getHistory
 ********************************************************************************
 *
 * Summary:
-*   Create the payload of the log to be saved in the EEPROM. It is composed of 
-*   60 bytes for each page, except the last one (fifth page) because by storing
-*   6 FIFO downsampled by 2, we have 288 bytes and 60*5 = 300 bytes, so this 
-*   function adds 12 bytes of 0 padding at the end of the last FIFO data to
-*   match precisely 5 page in the EEPROM.
+*   Copy the most recent FIFO stored in the local queue, in chronological order,
+*   inside the buffer provided. Each FIFO is made of
+*   LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED bytes of decimated data (32 /
+*   LIS3DH_DOWN_SAMPLE rows of 3 axis values X, Y, Z, i.e. 24 bytes with the
+*   default ratio of 4).
 *
 * Parameters:  
-*   messagge: array to be filled qith 60 IMU data from queue
-*   index: page number to be stored
+*   buffer: array to be filled with IMU data from queue
+*   nFifo: number of FIFO to be copied (max 6)
 *
 * Return:
-*   None
+*   Number of bytes written in the buffer.
 *
 *******************************************************************************/
-void IMU_getPayload(uint8_t *messagge, uint8_t index)
+uint16_t IMU_getHistory(uint8_t *buffer, uint8_t nFifo)
 {
-    // from 0 index to 1 index base
-    index = index+1;
-    
-    // Check if it's the last page
-    if(index == 5)
-    {
-        // copy the last 48 bytes in the message and insert 0 in the last empty positions
-        memset(messagge, 0, 60);
-        memcpy(messagge, IMU_log_queue, 48);
-    }
-    else
+    // Avoid reading outside the queue
+    if (nFifo > LIS3DH_FIFO_STORED)
     {
-        memcpy(messagge, &IMU_log_queue[288 - index*60], 60);
+        nFifo = LIS3DH_FIFO_STORED;
     }
+    
+    // Copy the last nFifo of the queue
+    uint16_t n_bytes = nFifo * LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED;
+    memcpy(buffer, &IMU_log_queue[LIS3DH_BYTES_IN_LOG_BUFFER - n_bytes], n_bytes);
+    
+    return n_bytes;
 }
 
 
@@ -335,11 +361,12 @@ void IMU_getPayload(uint8_t *messagge, uint8_t index)
 ********************************************************************************
 *
 * Summary:
-*   Send burst of raw data(one FIFO) from IMU, considering only high register 
-*   for each axis because of low power mode selection.
+*   Send burst of data (one FIFO) from IMU, given as rows of 3 axis value X, Y, Z
+*   (high registers only because of low power mode selection, possibly filtered
+*   by the DSP chain).
 *
 * Parameters:  
-*   buffer: array to be sent over UART
+*   buffer: array of 32 rows to be sent over UART
 *
 * Return:
 *   None
@@ -351,14 +378,8 @@ void IMU_DataSend(uint8_t *buffer)
     DataSend[0] = 0xA0;
     DataSend[4] = 0xC0;
     
-    // Buffer storing only high registers read from the IMU (8 bit configuration, low power mode)
-    uint8_t high_reg_data[LIS3DH_BYTES_IN_FIFO_HIGH_REG];
-    
-     // Save only high registers 
-    for(uint8_t i = 0; i < LIS3DH_BYTES_IN_FIFO_HIGH_REG; i++)
-    {
-        high_reg_data[i] = buffer[i*2 +1];
-    }
+    // Rows of high registers
+    uint8_t *high_reg_data = buffer;
 
     // Send 3 registers at time via UART
     for(int i = 0; i < 32 ; i++)
@@ -368,7 +389,7 @@ void IMU_DataSend(uint8_t *buffer)
         {   
             DataSend[j] = high_reg_data[i*3 + j-1];
         }
-        UART_PutArray(DataSend, 5);
+        SERIAL_PutArray(SERIAL_CHANNEL_STREAM, DataSend, 5);
     }
 }
 
@@ -378,8 +399,8 @@ void IMU_DataSend(uint8_t *buffer)
 ********************************************************************************
 *
 * Summary:
-*   Change mode from bypass to fifo in order to reset the FIFO and allow new
-*   incoming interrupts.
+*   Change mode from bypass to fifo (or stream-to-fifo) in order to reset the
+*   FIFO and allow new incoming interrupts.
 *
 * Parameters:  
 *   None
@@ -401,7 +422,7 @@ void IMU_ResetFIFO(void)
     
     
     // Set FIFO mode again
-    uint8_t FIFOTX[2] = {LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_CTRL_REG_FIFO_MODE};
+    uint8_t FIFOTX[2] = {LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_CTRL_REG_RUN_MODE};
 	temp = 0;
 	SPI_IMU_Interface_Multi_RW(FIFOTX, 2, &temp, 0);
 }
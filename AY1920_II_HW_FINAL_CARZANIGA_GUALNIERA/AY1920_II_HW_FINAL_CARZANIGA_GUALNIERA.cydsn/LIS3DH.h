@@ -14,6 +14,9 @@
 
     /* Include required libraries. */
     #include "SPI_Interface.h"
+    #include "Decimator.h"
+    #include "Profiler.h"
+    #include "Serial.h"
     #include "project.h"
     
     /* IMU Constants */
@@ -22,9 +25,9 @@
     #define LIS3DH_BYTES_IN_FIFO 192
     #define LIS3DH_BYTES_IN_FIFO_HIGH_REG 96
     #define LIS3DH_FIFO_STORED 6
-    #define LIS3DH_DOWN_SAMPLE 2
-    #define LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED LIS3DH_BYTES_IN_FIFO_HIGH_REG/LIS3DH_DOWN_SAMPLE
-    #define LIS3DH_BYTES_IN_LOG_BUFFER LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED * LIS3DH_FIFO_STORED // 16 levels * 3 registers * 6 FIFO
+    #define LIS3DH_DOWN_SAMPLE 4 // Decimation ratio of logged data (2, 4 or 8)
+    #define LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED (LIS3DH_BYTES_IN_FIFO_HIGH_REG/LIS3DH_DOWN_SAMPLE)
+    #define LIS3DH_BYTES_IN_LOG_BUFFER (LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED * LIS3DH_FIFO_STORED) // 32/DOWN_SAMPLE levels * 3 registers * 6 FIFO
     
     /* Buffer that store read data from IMU of one FIFO*/
     uint8_t IMU_DataBuffer[LIS3DH_BYTES_IN_FIFO];
@@ -55,6 +58,9 @@
       
     /* Hex value to set low power mode to the accelerator and 200Hz data rate. */
     #define LIS3DH_CTRL_REG1_START_XYZ  0x6F
+    
+    /* Output data rate set by LIS3DH_CTRL_REG1_START_XYZ (keep them consistent). */
+    #define LIS3DH_ODR_HZ               200
 
     /* Address of the Control register 3. */
     #define LIS3DH_CTRL_REG3 0x22
@@ -89,12 +95,28 @@
     /* Hex value to enable FIFO mode. */
     #define LIS3DH_FIFO_CTRL_REG_FIFO_MODE 0x40
     
+    /* Hex value to enable stream-to-FIFO mode triggered by INT1. */
+    #define LIS3DH_FIFO_CTRL_REG_STREAM_TO_FIFO_MODE 0xC0
+    
+    /* Set to 1 to let the LIS3DH hold the samples around the over threshold event. */
+    #define LIS3DH_TRIGGER_CAPTURE 1
+    
+    /* FIFO mode used during data acquisition. */
+    #if (LIS3DH_TRIGGER_CAPTURE == 1)
+        #define LIS3DH_FIFO_CTRL_REG_RUN_MODE LIS3DH_FIFO_CTRL_REG_STREAM_TO_FIFO_MODE
+    #else
+        #define LIS3DH_FIFO_CTRL_REG_RUN_MODE LIS3DH_FIFO_CTRL_REG_FIFO_MODE
+    #endif
+    
     /* Address of the FIFO Control register. */
     #define LIS3DH_FIFO_SRC_REG 0x2F
     
     /* Binary mask to check if FIFO_SRC_REG has overrun bit set to 1. */
     #define LIS3DH_FIFO_SRC_REG_OVR_MASK 0b01000000
     
+    /* Binary mask to get number of unread samples from FIFO_SRC_REG. */
+    #define LIS3DH_FIFO_SRC_REG_FSS_MASK 0b00011111
+    
     /* Address of the INT1 CFG register. */
     #define LIS3DH_INT1_CFG 0x30
     
@@ -110,6 +132,11 @@
     /* Mask for INT1 SRC register to detect isr occurrences. */
     #define LIS3DH_INT1_SRC_IA_MASK 0b01000000
     
+    /* Masks for INT1 SRC register to detect which axis crossed the threshold. */
+    #define LIS3DH_INT1_SRC_X_MASK 0b00000011
+    #define LIS3DH_INT1_SRC_Y_MASK 0b00001100
+    #define LIS3DH_INT1_SRC_Z_MASK 0b00110000
+    
     /* Address of the INT1 THS register. */
     #define LIS3DH_INT1_THS 0x32
     
@@ -136,7 +163,8 @@
     void IMU_ReadFIFO(uint8_t *buffer);
     void IMU_DataSend(uint8_t *buffer);
     void IMU_StoreFIFO(uint8_t *buffer);
-    void IMU_getPayload(uint8_t *messagge, uint8_t index);
+    uint8_t IMU_decimateFIFO(uint8_t *buffer, uint8_t *rawData, uint8_t downSample);
+    uint16_t IMU_getHistory(uint8_t *buffer, uint8_t nFifo);
     void IMU_ResetFIFO(void);
     
 #endif
@@ -0,0 +1,564 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * to keep a RAM copy of the catalog of logs
+ * stored inside the EEPROM memory.
+ *
+ * The catalog is rebuilt at boot by jumping
+ * from one log descriptor to the next one
+ * and it is kept updated by the staging queue
+ * every time a log is written.
+ *
+ * A binary min-heap of catalog indices is
+ * ordered by peak magnitude, so that the
+ * weakest stored log is always at the root:
+ *
+ *              [min peak]
+ *              /        \
+ *          [peak]      [peak]
+ *          /    \      /    \
+ *
+ * -> Finding the retention victim is O(1).
+ *
+ * -> Replacing the victim with a stronger
+ *    log and restoring the heap is O(log n).
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "LogCatalog.h"
+
+
+/* Catalog entries in storage order. */
+static log_entry_t catalog_entries[LOG_CATALOG_SIZE];
+static uint8_t catalog_count;
+
+/* Min-heap of catalog indices ranked by peak magnitude. */
+static uint8_t catalog_heap[LOG_CATALOG_SIZE];
+
+/* Log IDs currently stored, one bit each. */
+static uint8_t catalog_used_id[32];
+static uint8_t catalog_next_id;
+
+
+/*******************************************************************************
+* Function Name: CATALOG_peakAt
+********************************************************************************
+*
+* Summary:
+*   Get peak magnitude of the catalog entry at the given heap position.
+*
+* Parameters:  
+*   Heap position.
+*
+* Return:
+*   16-bit peak squared magnitude.
+*
+*******************************************************************************/
+static uint16_t CATALOG_peakAt(uint8_t heapIndex)
+{
+    return catalog_entries[catalog_heap[heapIndex]].peak;
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_swap
+********************************************************************************
+*
+* Summary:
+*   Swap two heap positions.
+*
+* Parameters:  
+*   Heap positions.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void CATALOG_swap(uint8_t a, uint8_t b)
+{
+    uint8_t tmp = catalog_heap[a];
+    catalog_heap[a] = catalog_heap[b];
+    catalog_heap[b] = tmp;
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_siftUp
+********************************************************************************
+*
+* Summary:
+*   Move the heap element at the given position toward the root until its
+*   parent is weaker.
+*
+* Parameters:  
+*   Heap position.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void CATALOG_siftUp(uint8_t heapIndex)
+{
+    while (heapIndex > 0)
+    {
+        uint8_t parent = (heapIndex - 1) / 2;
+        
+        // Stop when heap property is satisfied
+        if (CATALOG_peakAt(parent) <= CATALOG_peakAt(heapIndex))
+        {
+            break;
+        }
+        
+        CATALOG_swap(parent, heapIndex);
+        heapIndex = parent;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_siftDown
+********************************************************************************
+*
+* Summary:
+*   Move the heap element at the given position toward the leaves until both
+*   children are stronger.
+*
+* Parameters:  
+*   Heap position.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void CATALOG_siftDown(uint8_t heapIndex)
+{
+    while (1)
+    {
+        uint16_t left = 2 * heapIndex + 1;
+        uint16_t right = left + 1;
+        uint8_t smallest = heapIndex;
+        
+        // Find weakest among element and children
+        if ((left < catalog_count) && (CATALOG_peakAt(left) < CATALOG_peakAt(smallest)))
+        {
+            smallest = left;
+        }
+        if ((right < catalog_count) && (CATALOG_peakAt(right) < CATALOG_peakAt(smallest)))
+        {
+            smallest = right;
+        }
+        
+        // Stop when heap property is satisfied
+        if (smallest == heapIndex)
+        {
+            break;
+        }
+        
+        CATALOG_swap(smallest, heapIndex);
+        heapIndex = smallest;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_Init
+********************************************************************************
+*
+* Summary:
+*   Rebuild the catalog by scanning the descriptors of the logs stored inside
+*   the EEPROM memory, then build the heap in place.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CATALOG_Init(void)
+{
+    // Empty catalog
+    catalog_count = 0;
+    memset(catalog_used_id, 0, sizeof(catalog_used_id));
+    catalog_next_id = EEPROM_retrieveLogNextID();
+    
+    // Scan only written log pages
+    uint16_t page_count = EEPROM_retrieveLogPages();
+    uint16_t page_index = 0;
+    
+    while ((page_index < page_count) && (catalog_count < LOG_CATALOG_SIZE))
+    {
+        // Read descriptor of the log
+        uint16_t addrPtr = LOG_DATA_BASE_ADDR + page_index * SPI_EEPROM_PAGE_SIZE;
+        uint8_t n_pages = EEPROM_retrieveLogPageCount(addrPtr);
+        if (n_pages == 0)
+        {
+            // Corrupted descriptor, stop scanning
+            break;
+        }
+        
+        // Add catalog entry
+        log_entry_t* entry = &catalog_entries[catalog_count];
+        entry->pageIndex = page_index;
+        entry->pages = n_pages;
+        entry->logID = EEPROM_readByte(addrPtr);
+        entry->peak = EEPROM_retrieveLogPeak(addrPtr);
+        catalog_heap[catalog_count] = catalog_count;
+        catalog_used_id[entry->logID >> 3] |= (1 << (entry->logID & 0x07));
+        catalog_count++;
+        
+        // Jump to the next log
+        page_index += n_pages;
+    }
+    
+    // Build heap from the last parent up to the root
+    for (int16_t i = catalog_count / 2 - 1; i >= 0; i--)
+    {
+        CATALOG_siftDown(i);
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_getCount
+********************************************************************************
+*
+* Summary:
+*   Get number of logs inside the catalog.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Number of logs.
+*
+*******************************************************************************/
+uint8_t CATALOG_getCount(void)
+{
+    return catalog_count;
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_isFull
+********************************************************************************
+*
+* Summary:
+*   Check if no more logs can be appended to the catalog.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   1 if the catalog is full, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t CATALOG_isFull(void)
+{
+    return (catalog_count >= LOG_CATALOG_SIZE);
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_getNextID
+********************************************************************************
+*
+* Summary:
+*   Get the identification number for the next log, skipping IDs still used
+*   by stored logs once the 8-bit counter wraps around.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Free log identification number.
+*
+*******************************************************************************/
+uint8_t CATALOG_getNextID(void)
+{
+    uint8_t log_id = catalog_next_id;
+    
+    // At most LOG_CATALOG_SIZE IDs are in use, so a free one always exists
+    while (catalog_used_id[log_id >> 3] & (1 << (log_id & 0x07)))
+    {
+        log_id++;
+    }
+    
+    return log_id;
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_append
+********************************************************************************
+*
+* Summary:
+*   Add a log just stored after the last one to the catalog.
+*
+* Parameters:  
+*   First log page, number of pages, log ID, peak magnitude.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CATALOG_append(uint16_t pageIndex, uint8_t pages, uint8_t logID, uint16_t peak)
+{
+    if (catalog_count >= LOG_CATALOG_SIZE)
+    {
+        return;
+    }
+    
+    // Fill up new entry
+    log_entry_t* entry = &catalog_entries[catalog_count];
+    entry->pageIndex = pageIndex;
+    entry->pages = pages;
+    entry->logID = logID;
+    entry->peak = peak;
+    catalog_used_id[logID >> 3] |= (1 << (logID & 0x07));
+    catalog_next_id = logID + 1;
+    
+    // Push entry inside the heap
+    catalog_heap[catalog_count] = catalog_count;
+    catalog_count++;
+    CATALOG_siftUp(catalog_count - 1);
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_getVictim
+********************************************************************************
+*
+* Summary:
+*   Get pages of the weakest stored log, only if it is weaker than the new one.
+*
+* Parameters:  
+*   Peak magnitude of the new log, pointers to first page and number of pages
+*   of the victim.
+*
+* Return:
+*   1 if a victim is found, 0 if the new log has to be dropped.
+*
+*******************************************************************************/
+uint8_t CATALOG_getVictim(uint16_t peak, uint16_t* pageIndex, uint8_t* pages)
+{
+    // Compare with the heap root
+    if ((catalog_count == 0) || (CATALOG_peakAt(0) >= peak))
+    {
+        return 0;
+    }
+    
+    log_entry_t* entry = &catalog_entries[catalog_heap[0]];
+    *pageIndex = entry->pageIndex;
+    *pages = entry->pages;
+    return 1;
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_invalidateVictim
+********************************************************************************
+*
+* Summary:
+*   Mark the weakest log as no longer stored before its pages are overwritten,
+*   so that it is neither found nor downloaded while they hold a mix of two
+*   events. The entry stays at the heap root with no pages until replaced.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CATALOG_invalidateVictim(void)
+{
+    if (catalog_count == 0)
+    {
+        return;
+    }
+    
+    // Release old ID
+    log_entry_t* entry = &catalog_entries[catalog_heap[0]];
+    catalog_used_id[entry->logID >> 3] &= ~(1 << (entry->logID & 0x07));
+    entry->pages = 0;
+    entry->peak = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_replaceVictim
+********************************************************************************
+*
+* Summary:
+*   Replace the invalidated weakest log with the one just written over its
+*   pages and restore the heap.
+*
+* Parameters:  
+*   Log ID, number of pages, peak magnitude.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CATALOG_replaceVictim(uint8_t logID, uint8_t pages, uint16_t peak)
+{
+    if (catalog_count == 0)
+    {
+        return;
+    }
+    
+    // Take the new ID
+    log_entry_t* entry = &catalog_entries[catalog_heap[0]];
+    catalog_used_id[logID >> 3] |= (1 << (logID & 0x07));
+    catalog_next_id = logID + 1;
+    
+    // Stronger log goes down the heap
+    entry->logID = logID;
+    entry->pages = pages;
+    entry->peak = peak;
+    CATALOG_siftDown(0);
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_findID
+********************************************************************************
+*
+* Summary:
+*   Search the catalog for a given log identification number.
+*
+* Parameters:  
+*   Log identification number.
+*
+* Return:
+*   16-bit address of log.
+*
+* Side effects:
+*   If the log is not found, an invalid address of 0xFFFF is returned.
+*
+*******************************************************************************/
+uint16_t CATALOG_findID(uint8_t logID)
+{
+    for (uint8_t i=0; i<catalog_count; i++)
+    {
+        if ((catalog_entries[i].logID == logID) && (catalog_entries[i].pages != 0))
+        {
+            return LOG_DATA_BASE_ADDR + catalog_entries[i].pageIndex * SPI_EEPROM_PAGE_SIZE;
+        }
+    }
+    
+    // Return invalid address
+    return LOG_INVALID_ADDR;
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_getEntry
+********************************************************************************
+*
+* Summary:
+*   Get a catalog entry in storage order.
+*
+* Parameters:  
+*   Entry index.
+*
+* Return:
+*   Catalog entry pointer.
+*
+*******************************************************************************/
+const log_entry_t* CATALOG_getEntry(uint8_t index)
+{
+    return &catalog_entries[index];
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_getNewestID
+********************************************************************************
+*
+* Summary:
+*   Get the identification number of the last stored log.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Log identification number.
+*
+*******************************************************************************/
+uint8_t CATALOG_getNewestID(void)
+{
+    return catalog_next_id - 1;
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_isInSpan
+********************************************************************************
+*
+* Summary:
+*   Check if the ID of a catalog entry lies in a span of IDs. IDs are assigned
+*   in increasing order and wrap around after 255, so the span is taken from
+*   the first ID forward up to the last one (first 0 and last 255 select all).
+*   A log being overwritten is never inside the span.
+*
+* Parameters:  
+*   Entry index, first and last log ID of the span.
+*
+* Return:
+*   1 if the log is inside the span, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t CATALOG_isInSpan(uint8_t index, uint8_t firstID, uint8_t lastID)
+{
+    return (catalog_entries[index].pages != 0) && ((uint8_t)(catalog_entries[index].logID - firstID) <= (uint8_t)(lastID - firstID));
+}
+
+
+/*******************************************************************************
+* Function Name: CATALOG_sendEntry
+********************************************************************************
+*
+* Summary:
+*   Send a catalog entry over UART: log ID, number of pages, peak magnitude,
+*   interrupt register, timestamp and event summary of the log. Header and
+*   summary are read from the first bytes of the log, so that the host can
+*   rank and filter logs without downloading their payload. Entries are sent
+*   in storage order after the number of logs. A log being overwritten is sent
+*   with no pages and an empty header and summary.
+*
+* Parameters:  
+*   Entry index.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void CATALOG_sendEntry(uint8_t index)
+{
+    // Read log header and event descriptor at once
+    uint8_t header[LOG_MESSAGE_HEADER_BYTE + LOG_EVENT_DESC_BYTE];
+    memset(header, 0, sizeof(header));
+    if (catalog_entries[index].pages != 0)
+    {
+        uint16_t addrPtr = LOG_DATA_BASE_ADDR + catalog_entries[index].pageIndex * SPI_EEPROM_PAGE_SIZE;
+        EEPROM_readPage(addrPtr, header, LOG_MESSAGE_HEADER_BYTE + LOG_EVENT_DESC_BYTE);
+    }
+    
+    uint8_t buffer[LOG_CATALOG_ENTRY_BYTE];
+    buffer[0] = catalog_entries[index].logID;
+    buffer[1] = catalog_entries[index].pages;
+    buffer[2] = catalog_entries[index].peak & 0xFF;
+    buffer[3] = (catalog_entries[index].peak >> 8) & 0xFF;
+    buffer[4] = header[1];
+    buffer[5] = header[2];
+    buffer[6] = header[3];
+    memcpy(&buffer[7], &header[LOG_MESSAGE_HEADER_BYTE + LOG_EVENT_DESC_SUMMARY], LOG_EVENT_SUMMARY_BYTE);
+    SERIAL_PutArrayWait(SERIAL_CHANNEL_BULK, buffer, LOG_CATALOG_ENTRY_BYTE);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,58 @@
+/* ========================================
+ *
+ * This header file contains prototypes of
+ * the functions used to keep a RAM copy of
+ * the catalog of logs stored inside the
+ * EEPROM memory, ranked by severity.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __LOG_CATALOG_H__
+
+    #define __LOG_CATALOG_H__
+
+    /* Project dependencies. */
+    #include "project.h"
+    #include "LogUtils.h"
+    #include "25LC256.h"
+
+    /* Useful constants definition. */
+    #define LOG_CATALOG_SIZE        (LOG_DATA_PAGE_COUNT / LOG_EVENT_MIN_PAGES)
+    #define LOG_CATALOG_ENTRY_BYTE  (7 + LOG_EVENT_SUMMARY_BYTE)
+
+    /* Retention policy once the log memory is full. Severity mode replaces
+       only the single weakest log: a longer event is cut around its trigger
+       to the pages of that log. */
+    #define LOG_RETENTION_DROP      0
+    #define LOG_RETENTION_SEVERITY  1
+    #define LOG_RETENTION_MODE      LOG_RETENTION_SEVERITY
+
+    /* Catalog entry type. */
+    typedef struct {
+        uint16_t pageIndex;
+        uint8_t pages;
+        uint8_t logID;
+        uint16_t peak;
+    } log_entry_t;
+
+    /* Function prototype declaration. */
+    void CATALOG_Init(void);
+    uint8_t CATALOG_getCount(void);
+    uint8_t CATALOG_isFull(void);
+    uint8_t CATALOG_getNextID(void);
+    void CATALOG_append(uint16_t pageIndex, uint8_t pages, uint8_t logID, uint16_t peak);
+    uint8_t CATALOG_getVictim(uint16_t peak, uint16_t* pageIndex, uint8_t* pages);
+    void CATALOG_invalidateVictim(void);
+    void CATALOG_replaceVictim(uint8_t logID, uint8_t pages, uint16_t peak);
+    uint16_t CATALOG_findID(uint8_t logID);
+    const log_entry_t* CATALOG_getEntry(uint8_t index);
+    uint8_t CATALOG_getNewestID(void);
+    uint8_t CATALOG_isInSpan(uint8_t index, uint8_t firstID, uint8_t lastID);
+    void CATALOG_sendEntry(uint8_t index);
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,383 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * to stage over threshold events in RAM before
+ * they are stored inside the EEPROM memory.
+ *
+ * The staging queue is a circular buffer of
+ * log events:
+ *
+ * +------+------+------+------+
+ * |  E0  |  E1  |  E2  |  E3  |
+ * +------+------+------+------+
+ *    ^             ^
+ *   head          tail
+ *
+ * -> The event under capture is built in place
+ *    inside the tail slot, which is made
+ *    available to the drain only once the
+ *    event has been committed.
+ *
+ * -> The head event is written to the EEPROM
+ *    one page per main loop iteration without
+ *    waiting for the write cycle to complete,
+ *    so that FIFO reading and event capture
+ *    are never stalled by the EEPROM.
+ *
+ * When all slots are busy the new event is
+ * dropped and the overflow counter is increased.
+ *
+ * When the log memory is full the event is
+ * either dropped or, in severity retention
+ * mode, written over the pages of the weakest
+ * stored log provided that its peak magnitude
+ * is higher, even once the event is cut to
+ * the pages of that log (a window around the
+ * trigger is kept). The weakest log is
+ * removed from the catalog before its first
+ * page is overwritten.
+ *
+ * Once an event is stored, a notification
+ * (ID, pages, peak, INT1_SRC, timestamp and
+ * summary) is pushed over the event channel
+ * of the multiplexed UART link, so that the
+ * host can fetch it without polling.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "LogQueue.h"
+
+
+/* Staging queue of log events. */
+static log_event_t queue_events[LOG_QUEUE_SIZE];
+static uint8_t queue_head;
+static uint8_t queue_tail;
+static uint8_t queue_count;
+
+/* Drain status of the head event. */
+static uint16_t drain_first_page;
+static uint8_t drain_pages;
+static uint8_t drain_index;
+static uint8_t drain_replace;
+static uint8_t drain_hold;
+
+
+/*******************************************************************************
+* Function Name: QUEUE_Init
+********************************************************************************
+*
+* Summary:
+*   Empty the staging queue and reset event counters.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void QUEUE_Init(void)
+{
+    // Empty queue
+    queue_head = 0;
+    queue_tail = 0;
+    queue_count = 0;
+    
+    // Nothing to drain
+    drain_pages = 0;
+    drain_index = 0;
+    drain_hold = 0;
+    
+    // Reset counters
+    QUEUE_overflowCount = 0;
+    QUEUE_memoryFullCount = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: QUEUE_openEvent
+********************************************************************************
+*
+* Summary:
+*   Get the free slot at the tail of the queue to capture a new log event.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Log event pointer, NULL if the queue is full.
+*
+* Side effects:
+*   If the queue is full the overflow counter is increased.
+*
+*******************************************************************************/
+log_event_t* QUEUE_openEvent(void)
+{
+    // Check if there is a free slot
+    if (queue_count >= LOG_QUEUE_SIZE)
+    {
+        // Count dropped event
+        QUEUE_overflowCount++;
+        return NULL;
+    }
+    
+    // Return tail slot
+    return &queue_events[queue_tail];
+}
+
+
+/*******************************************************************************
+* Function Name: QUEUE_commitEvent
+********************************************************************************
+*
+* Summary:
+*   Make the event captured inside the tail slot available to be drained to the
+*   EEPROM memory.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void QUEUE_commitEvent(void)
+{
+    // Check if there is a free slot
+    if (queue_count < LOG_QUEUE_SIZE)
+    {
+        // Move tail to the next slot
+        queue_tail = (queue_tail + 1) % LOG_QUEUE_SIZE;
+        queue_count++;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: QUEUE_getPendingEvents
+********************************************************************************
+*
+* Summary:
+*   Get number of committed events still waiting to be stored in the EEPROM.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Number of pending events.
+*
+*******************************************************************************/
+uint8_t QUEUE_getPendingEvents(void)
+{
+    return queue_count;
+}
+
+
+/*******************************************************************************
+* Function Name: QUEUE_notifyEvent
+********************************************************************************
+*
+* Summary:
+*   Push a notification of a stored event over the event channel, with the
+*   same layout of catalog entries. Notifications are sent only in multiplexed
+*   link mode, so that raw responses counted by the host are never mixed with
+*   them, and they are dropped if the channel is full.
+*
+* Parameters:  
+*   Log event pointer, number of pages stored.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void QUEUE_notifyEvent(log_event_t* event, uint8_t pages)
+{
+    if (SERIAL_getLinkMode() != SERIAL_LINK_MUX)
+    {
+        return;
+    }
+    
+    uint8_t buffer[LOG_NOTIFY_BYTE];
+    buffer[0] = event->logID;
+    buffer[1] = pages;
+    buffer[2] = event->peak & 0xFF;
+    buffer[3] = (event->peak >> 8) & 0xFF;
+    buffer[4] = event->intReg;
+    buffer[5] = event->timestamp & 0xFF;
+    buffer[6] = (event->timestamp >> 8) & 0xFF;
+    memcpy(&buffer[7], event->summary, LOG_EVENT_SUMMARY_BYTE);
+    SERIAL_PutArray(SERIAL_CHANNEL_EVENT, buffer, LOG_NOTIFY_BYTE);
+}
+
+
+/*******************************************************************************
+* Function Name: QUEUE_drainEvent
+********************************************************************************
+*
+* Summary:
+*   Non-blocking function that moves the head event of the queue toward the
+*   EEPROM memory by one step at each call:
+*   +--------------------------------------------------------------+
+*   | 1) Assign the log ID and check available memory (or victim)  |
+*   | 2) Write one log page (repeated for all pages of the event)  |
+*   | 3) Update counters and catalog, notify host and release slot |
+*   +--------------------------------------------------------------+
+*   Nothing is done while the EEPROM is completing a write cycle, and no new
+*   event is started while the drain is held.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void QUEUE_drainEvent(void)
+{
+    // Nothing to drain
+    if (queue_count == 0)
+    {
+        return;
+    }
+    
+    // Wait for previous write cycle without blocking
+    if (EEPROM_readStatus() & SPI_EEPROM_WRITE_IN_PROGRESS)
+    {
+        return;
+    }
+    
+    log_event_t* event = &queue_events[queue_head];
+    
+    // Start draining a new event
+    if (drain_pages == 0)
+    {
+        // Events stay in RAM while the log memory is held
+        if (drain_hold)
+        {
+            return;
+        }
+        
+        // Assign ID number not used by stored logs
+        event->logID = CATALOG_getNextID();
+        event->peak = LOG_getEventPeak(event);
+        event->pages = LOG_getEventPages(event);
+        
+        // Locate first available page
+        drain_first_page = EEPROM_retrieveLogPages();
+        drain_pages = event->pages;
+        drain_index = 0;
+        drain_replace = 0;
+        
+        // Check if event fits inside log memory
+        if ((drain_first_page + drain_pages > LOG_DATA_PAGE_COUNT) || CATALOG_isFull())
+        {
+#if (LOG_RETENTION_MODE == LOG_RETENTION_SEVERITY)
+            // Overwrite weakest log if the new one is stronger, even once cut to its pages
+            if (CATALOG_getVictim(event->peak, &drain_first_page, &drain_pages))
+            {
+                LOG_fitEvent(event, drain_pages);
+                event->peak = LOG_getEventPeak(event);
+                drain_replace = CATALOG_getVictim(event->peak, &drain_first_page, &drain_pages);
+            }
+#endif
+            if (drain_replace == 0)
+            {
+                // Count dropped event and release slot
+                QUEUE_memoryFullCount++;
+                drain_pages = 0;
+                queue_head = (queue_head + 1) % LOG_QUEUE_SIZE;
+                queue_count--;
+                return;
+            }
+            
+            // Victim pages no longer hold a valid log
+            CATALOG_invalidateVictim();
+        }
+        
+        // Summary and payload describe the samples actually stored
+        LOG_summarizeEvent(event);
+        LOG_packEvent(event);
+        return;
+    }
+    
+    // Write next page of the event
+    if (drain_index < drain_pages)
+    {
+        uint8_t buffer[LOG_MESSAGE_TOT_BYTE];
+        log_t log_page = LOG_getEventMessage(event, drain_index);
+        LOG_unpackMessage(buffer, &log_page);
+        
+        uint16_t page_addr = LOG_DATA_BASE_ADDR + (drain_first_page + drain_index) * SPI_EEPROM_PAGE_SIZE;
+        EEPROM_writePage(page_addr, buffer, SPI_EEPROM_PAGE_SIZE);
+        drain_index++;
+        return;
+    }
+    
+    if (drain_replace)
+    {
+        // Victim pages overwritten, only next ID changes
+        EEPROM_writeByte(CTRL_REG_LOG_NEXT_ID, event->logID + 1);
+        CATALOG_replaceVictim(event->logID, drain_pages, event->peak);
+    }
+    else
+    {
+        // All pages written, expose the event by updating counters
+        EEPROM_writeLogCounters(drain_first_page + drain_pages, CATALOG_getCount() + 1, event->logID + 1);
+        CATALOG_append(drain_first_page, drain_pages, event->logID, event->peak);
+    }
+    
+    // Event can be downloaded from now on
+    QUEUE_notifyEvent(event, drain_pages);
+    
+    // Release slot
+    drain_pages = 0;
+    queue_head = (queue_head + 1) % LOG_QUEUE_SIZE;
+    queue_count--;
+}
+
+
+/*******************************************************************************
+* Function Name: QUEUE_holdDrain
+********************************************************************************
+*
+* Summary:
+*   Hold or release the drain of staged events. The event being written is
+*   completed anyway, so that the log memory can be erased once
+*   QUEUE_isDraining() returns 0.
+*
+* Parameters:  
+*   1 to hold the drain, 0 to release it.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void QUEUE_holdDrain(uint8_t hold)
+{
+    drain_hold = hold;
+}
+
+
+/*******************************************************************************
+* Function Name: QUEUE_isDraining
+********************************************************************************
+*
+* Summary:
+*   Check if an event is being written to the EEPROM.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   1 if an event is being written, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t QUEUE_isDraining(void)
+{
+    return (drain_pages != 0);
+}
+
+/* [] END OF FILE */
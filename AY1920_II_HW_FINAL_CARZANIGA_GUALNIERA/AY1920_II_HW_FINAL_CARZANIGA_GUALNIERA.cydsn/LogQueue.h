@@ -0,0 +1,43 @@
+/* ========================================
+ *
+ * This header file contains prototypes of
+ * the functions used to stage captured log
+ * events in RAM and to drain them to the
+ * EEPROM memory in background.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __LOG_QUEUE_H__
+    
+    #define __LOG_QUEUE_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "LogUtils.h"
+    #include "25LC256.h"
+    #include "LogCatalog.h"
+    #include "Serial.h"
+    
+    /* Useful constants definition. */
+    #define LOG_QUEUE_SIZE  4
+    #define LOG_NOTIFY_BYTE LOG_CATALOG_ENTRY_BYTE  // Same layout as catalog entries
+    
+    /* Event counters. */
+    uint16_t QUEUE_overflowCount;
+    uint16_t QUEUE_memoryFullCount;
+    
+    /* Function prototype declaration. */
+    void QUEUE_Init(void);
+    log_event_t* QUEUE_openEvent(void);
+    void QUEUE_commitEvent(void);
+    uint8_t QUEUE_getPendingEvents(void);
+    void QUEUE_drainEvent(void);
+    void QUEUE_holdDrain(uint8_t hold);
+    uint8_t QUEUE_isDraining(void);
+    
+#endif
+
+/* [] END OF FILE */
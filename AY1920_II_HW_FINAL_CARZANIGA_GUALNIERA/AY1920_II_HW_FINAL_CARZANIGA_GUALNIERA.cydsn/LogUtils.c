@@ -32,6 +32,86 @@
  *       total of 20 rows (60 bytes)
  *
  * ========================================
+ *
+ * An over threshold event is stored as a
+ * variable number of consecutive log messages
+ * sharing the same header. The data field of
+ * the first message starts with an event
+ * descriptor, then the event payload flows
+ * over the data field of all messages:
+ *
+ * +--------------------+
+ * |    Page count      |   <1 byte>
+ * +--------------------+
+ * |   Payload length   |   <2 bytes>
+ * +--------------------+
+ * |   Trigger sample   |   <1 byte>
+ * +--------------------+
+ * |   Peak magnitude   |   <2 bytes>
+ * +--------------------+
+ * |   Payload format   |   <1 byte>
+ * +--------------------+
+ * |     Core start     |   <1 byte>
+ * +--------------------+
+ * |    Core length     |   <1 byte>
+ * +--------------------+
+ * |   Sampling rate    |   <1 byte>
+ * +--------------------+
+ * |      Summary       |   <10 bytes>
+ * +--------------------+
+ * |                    |
+ * |      Payload       |   <length bytes>
+ * |                    |
+ * +--------------------+
+ *
+ * Page count: number of log messages (EEPROM
+ *             pages) used by the event
+ *
+ * Payload length: number of valid data bytes,
+ *                 the last page is padded
+ *                 with zeros
+ *
+ * Trigger sample: index of the X, Y, Z row
+ *                 of the payload at which the
+ *                 over threshold event occurred
+ *
+ * Peak magnitude: maximum squared magnitude
+ *                 X^2+Y^2+Z^2 of the payload,
+ *                 used to rank events severity
+ *
+ * Payload format: mask of the axes stored at
+ *                 full rate (bit 0 X, bit 1 Y,
+ *                 bit 2 Z). With all axes set
+ *                 the payload is made of X, Y, Z
+ *                 rows, otherwise rows of the
+ *                 full rate axes only are
+ *                 followed by rows of the other
+ *                 axes averaged every 8 samples
+ *
+ * Core start: index of the first sample of the
+ *             full rate core window
+ *
+ * Core length: number of samples of the core
+ *              window (the trigger FIFO), the
+ *              other samples are the context
+ *
+ * Sampling rate: decimation factor of context
+ *                (high nibble) and core (low
+ *                nibble) samples with respect
+ *                to the 200 Hz data rate
+ *
+ * Summary: features computed at capture time
+ *          to triage events without reading
+ *          the payload:
+ *          - peak of |X|, |Y|, |Z| (3 bytes)
+ *          - time from the trigger sample to
+ *            the peak magnitude sample in ms
+ *            (2 bytes, signed)
+ *          - RMS of X, Y, Z (3 bytes)
+ *          - time spent with any axis over
+ *            the INT1 threshold in ms (2 bytes)
+ *
+ * ========================================
 */
 
 
@@ -173,27 +253,638 @@ void LOG_packMessage(log_t* message, uint8_t* buffer)
 
 
 /*******************************************************************************
-* Function Name: LOG_sendData
+* Function Name: LOG_initEvent
+********************************************************************************
+*
+* Summary:
+*   Initialize an empty log event given all info about its occurrence.
+*
+* Parameters:  
+*   Log event pointer, log identification number, interrupt register content,
+*   timestamp, index of the payload sample at which the event occurred.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void LOG_initEvent(log_event_t* event, uint8_t logID, uint8_t intReg, uint16_t time, uint8_t trigger)
+{
+    // Assign event header
+    event->logID = logID;
+    event->intReg = intReg;
+    event->timestamp = time;
+    event->trigger = trigger;
+    
+    // Empty payload
+    event->pages = 0;
+    event->peak = 0;
+    event->format = LOG_EVENT_FORMAT_DENSE;
+    event->samples = 0;
+    event->coreStart = 0;
+    event->coreLength = 0;
+    event->length = 0;
+    memset(event->summary, 0, LOG_EVENT_SUMMARY_BYTE);
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_appendEvent
+********************************************************************************
+*
+* Summary:
+*   Append IMU data at the end of the event payload. Data exceeding the maximum
+*   event size is discarded.
+*
+* Parameters:  
+*   Log event pointer, data pointer, number of bytes to append.
+*
+* Return:
+*   1 if the event payload is full, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t LOG_appendEvent(log_event_t* event, uint8_t* dataPtr, uint16_t nBytes)
+{
+    // Clip data to the available space
+    uint16_t free_bytes = LOG_EVENT_MAX_DATA_BYTE - event->length;
+    if (nBytes > free_bytes)
+    {
+        nBytes = free_bytes;
+    }
+    
+    // Copy data at the end of the payload
+    memcpy(&event->data[event->length], dataPtr, nBytes);
+    event->length += nBytes;
+    
+    return (event->length == LOG_EVENT_MAX_DATA_BYTE);
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_appendEventCore
+********************************************************************************
+*
+* Summary:
+*   Append IMU data of the core window at the end of the event payload, saving
+*   its position since it is sampled at a different rate than the context.
+*
+* Parameters:  
+*   Log event pointer, data pointer, number of bytes to append.
+*
+* Return:
+*   1 if the event payload is full, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t LOG_appendEventCore(log_event_t* event, uint8_t* dataPtr, uint16_t nBytes)
+{
+    // Core window starts after the rows already stored
+    event->coreStart = event->length / 3;
+    uint8_t full = LOG_appendEvent(event, dataPtr, nBytes);
+    event->coreLength = event->length / 3 - event->coreStart;
+    
+    return full;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_getEventPeak
+********************************************************************************
+*
+* Summary:
+*   Compute the peak squared magnitude X^2+Y^2+Z^2 among all payload samples, 
+*   used as severity index of the event.
+*
+* Parameters:  
+*   Log event pointer.
+*
+* Return:
+*   16-bit peak squared magnitude.
+*
+*******************************************************************************/
+uint16_t LOG_getEventPeak(log_event_t* event)
+{
+    uint16_t peak = 0;
+    
+    // For all X, Y, Z rows of the (not yet packed) payload
+    for (uint16_t i=0; i+2<event->length; i+=3)
+    {
+        // Compute squared magnitude
+        int16_t x = (int8_t)event->data[i];
+        int16_t y = (int8_t)event->data[i+1];
+        int16_t z = (int8_t)event->data[i+2];
+        uint16_t magnitude = (uint16_t)(x*x) + (uint16_t)(y*y) + (uint16_t)(z*z);
+        
+        // Keep maximum value
+        if (magnitude > peak)
+        {
+            peak = magnitude;
+        }
+    }
+    
+    return peak;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_sqrt
+********************************************************************************
+*
+* Summary:
+*   Integer square root (bit by bit, no division).
+*
+* Parameters:  
+*   16-bit value.
+*
+* Return:
+*   Floor of square root.
+*
+*******************************************************************************/
+static uint8_t LOG_sqrt(uint16_t value)
+{
+    uint16_t root = 0;
+    uint16_t bit = 1U << 14;
+    
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    
+    return (uint8_t)root;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_getSamplePeriod
+********************************************************************************
+*
+* Summary:
+*   Get time between a payload sample and the next one, which depends on the
+*   sample being inside the full rate core window or the context.
+*
+* Parameters:  
+*   Log event pointer, sample index.
+*
+* Return:
+*   Sample period in ms.
+*
+*******************************************************************************/
+static uint8_t LOG_getSamplePeriod(log_event_t* event, uint16_t index)
+{
+    if ((index >= event->coreStart) && (index < event->coreStart + event->coreLength))
+    {
+        return LOG_CORE_DOWN_SAMPLE * LOG_SAMPLE_PERIOD_MS;
+    }
+    
+    return LOG_CONTEXT_DOWN_SAMPLE * LOG_SAMPLE_PERIOD_MS;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_summarizeEvent
+********************************************************************************
+*
+* Summary:
+*   Compute the summary features stored inside the event descriptor: per-axis
+*   peak and RMS, time from the trigger to the peak magnitude and time spent
+*   over the INT1 threshold. It must be called before packing the event,
+*   while the payload is still made of X, Y, Z rows.
+*
+* Parameters:  
+*   Log event pointer.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void LOG_summarizeEvent(log_event_t* event)
+{
+    uint8_t axis_peak[3] = {0, 0, 0};
+    uint32_t sum_square[3] = {0, 0, 0};
+    uint16_t peak = 0;
+    int16_t peak_time = 0;
+    int16_t trigger_time = 0;
+    uint16_t above_time = 0;
+    int16_t time = 0;
+    uint16_t samples = event->length / 3;
+    
+    // For all X, Y, Z rows of the (not yet packed) payload
+    for (uint16_t i=0; i<samples; i++)
+    {
+        uint16_t magnitude = 0;
+        uint8_t above = 0;
+        
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            int16_t value = (int8_t)event->data[3*i + axis];
+            uint8_t abs_value = (value < 0) ? -value : value;
+            
+            // Update per-axis features
+            if (abs_value > axis_peak[axis])
+            {
+                axis_peak[axis] = abs_value;
+            }
+            sum_square[axis] += value * value;
+            magnitude += value * value;
+            above |= (abs_value > LOG_EVENT_ABOVE_THS);
+        }
+        
+        // Keep time of peak magnitude and trigger sample
+        if (magnitude > peak)
+        {
+            peak = magnitude;
+            peak_time = time;
+        }
+        if (i == event->trigger)
+        {
+            trigger_time = time;
+        }
+        
+        // Accumulate time over threshold
+        uint8_t period = LOG_getSamplePeriod(event, i);
+        if (above)
+        {
+            above_time += period;
+        }
+        time += period;
+    }
+    
+    // Fill up summary bytes
+    int16_t time_to_peak = peak_time - trigger_time;
+    for (uint8_t axis=0; axis<3; axis++)
+    {
+        event->summary[LOG_EVENT_SUM_AXIS_PEAK + axis] = axis_peak[axis];
+        event->summary[LOG_EVENT_SUM_AXIS_RMS + axis] = (samples > 0) ? LOG_sqrt(sum_square[axis] / samples) : 0;
+    }
+    event->summary[LOG_EVENT_SUM_TTP_LOW] = (time_to_peak & 0xFF);
+    event->summary[LOG_EVENT_SUM_TTP_HIGH] = ((time_to_peak >> 8) & 0xFF);
+    event->summary[LOG_EVENT_SUM_ABOVE_LOW] = (above_time & 0xFF);
+    event->summary[LOG_EVENT_SUM_ABOVE_HIGH] = ((above_time >> 8) & 0xFF);
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_getFullAxes
 ********************************************************************************
 *
 * Summary:
-*   Send 64 bytes log type message over UART.
+*   Count number of axes stored at full rate by a payload format.
 *
 * Parameters:  
-*   Log type message pointer.
+*   Payload format.
+*
+* Return:
+*   Number of full rate axes.
+*
+*******************************************************************************/
+static uint8_t LOG_getFullAxes(uint8_t format)
+{
+    uint8_t n_axes = 0;
+    
+    for (uint8_t axis=0; axis<3; axis++)
+    {
+        n_axes += (format >> axis) & 0x01;
+    }
+    
+    return n_axes;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_getPackedLength
+********************************************************************************
+*
+* Summary:
+*   Compute payload length of a given number of samples once packed in the
+*   given format.
+*
+* Parameters:  
+*   Payload format, number of samples.
+*
+* Return:
+*   Payload length in bytes.
+*
+*******************************************************************************/
+static uint16_t LOG_getPackedLength(uint8_t format, uint16_t samples)
+{
+    uint8_t full_axes = LOG_getFullAxes(format);
+    uint16_t coarse_rows = (samples + LOG_EVENT_COARSE_RATIO - 1) / LOG_EVENT_COARSE_RATIO;
+    
+    return full_axes * samples + (3 - full_axes) * coarse_rows;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_getEventFormat
+********************************************************************************
+*
+* Summary:
+*   Get the mask of the axes to be stored at full rate from the INT1_SRC
+*   register content, i.e. the axes that crossed the threshold.
+*
+* Parameters:  
+*   Interrupt register content.
+*
+* Return:
+*   Payload format.
+*
+*******************************************************************************/
+uint8_t LOG_getEventFormat(uint8_t intReg)
+{
+    uint8_t format = 0;
+    
+    // Software trigger rules use the whole vector
+    if (intReg & TRIG_INT_REG_SOFTWARE)
+    {
+        return LOG_EVENT_FORMAT_DENSE;
+    }
+    
+    // Set triggering axes
+    if (intReg & LIS3DH_INT1_SRC_X_MASK)
+    {
+        format |= LOG_EVENT_FORMAT_X;
+    }
+    if (intReg & LIS3DH_INT1_SRC_Y_MASK)
+    {
+        format |= LOG_EVENT_FORMAT_Y;
+    }
+    if (intReg & LIS3DH_INT1_SRC_Z_MASK)
+    {
+        format |= LOG_EVENT_FORMAT_Z;
+    }
+    
+    // Keep all axes if no axis info is available
+    if (format == 0)
+    {
+        format = LOG_EVENT_FORMAT_DENSE;
+    }
+    
+    return format;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_getPayloadFormat
+********************************************************************************
+*
+* Summary:
+*   Get the format the event payload is packed in: only the triggering axes
+*   at full rate when sparse payloads are enabled, all of them otherwise.
+*
+* Parameters:  
+*   Log event pointer.
+*
+* Return:
+*   Payload format.
+*
+*******************************************************************************/
+static uint8_t LOG_getPayloadFormat(log_event_t* event)
+{
+#if (LOG_EVENT_SPARSE_PAYLOAD)
+    return LOG_getEventFormat(event->intReg);
+#else
+    return LOG_EVENT_FORMAT_DENSE;
+#endif
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_getEventPages
+********************************************************************************
+*
+* Summary:
+*   Compute number of log messages needed to store the event descriptor and
+*   the whole event payload once packed. The event must not be packed yet.
+*
+* Parameters:  
+*   Log event pointer.
+*
+* Return:
+*   Number of log messages (EEPROM pages).
+*
+*******************************************************************************/
+uint8_t LOG_getEventPages(log_event_t* event)
+{
+    uint16_t tot_bytes = LOG_EVENT_DESC_BYTE + LOG_getPackedLength(LOG_getPayloadFormat(event), event->length / 3);
+    return (uint8_t)((tot_bytes + LOG_MESSAGE_DATA_BYTE - 1) / LOG_MESSAGE_DATA_BYTE);
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_packEvent
+********************************************************************************
+*
+* Summary:
+*   Convert the X, Y, Z rows of the payload in place into the event format. 
+*   When sparse payloads are enabled only the axes that crossed the threshold
+*   are kept at full rate, while the other axes are replaced by their average
+*   over blocks of LOG_EVENT_COARSE_RATIO samples.
+*
+* Parameters:  
+*   Log event pointer.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void LOG_packEvent(log_event_t* event)
+{
+    // Keep whole rows only
+    event->samples = event->length / 3;
+    event->length = event->samples * 3;
+    event->format = LOG_getPayloadFormat(event);
+    
+    // Dense payload is already packed
+    if (event->format == LOG_EVENT_FORMAT_DENSE)
+    {
+        return;
+    }
+    
+    // Average coarse axes over blocks of samples
+    uint8_t coarse[2 * LOG_EVENT_MAX_COARSE];
+    uint16_t n_coarse = 0;
+    for (uint16_t row=0; row<event->samples; row+=LOG_EVENT_COARSE_RATIO)
+    {
+        uint8_t n_rows = LOG_EVENT_COARSE_RATIO;
+        if (row + n_rows > event->samples)
+        {
+            n_rows = event->samples - row;
+        }
+        
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            if (!(event->format & (1 << axis)))
+            {
+                int16_t sum = 0;
+                for (uint8_t k=0; k<n_rows; k++)
+                {
+                    sum += (int8_t)event->data[3*(row+k) + axis];
+                }
+                coarse[n_coarse++] = (uint8_t)(int8_t)(sum / n_rows);
+            }
+        }
+    }
+    
+    // Compact full rate axes in place (write index never overtakes read index)
+    uint16_t n_bytes = 0;
+    for (uint16_t row=0; row<event->samples; row++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            if (event->format & (1 << axis))
+            {
+                event->data[n_bytes++] = event->data[3*row + axis];
+            }
+        }
+    }
+    
+    // Append coarse rows
+    memcpy(&event->data[n_bytes], coarse, n_coarse);
+    event->length = n_bytes + n_coarse;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_fitEvent
+********************************************************************************
+*
+* Summary:
+*   Force the event to be stored in the given number of pages. Longer payloads
+*   are cut to the whole samples fitting the pages once packed, keeping a
+*   window around the trigger sample (1/LOG_FIT_PRE_TRIGGER_DIV of the rows
+*   before it) so that the core window and the peak are not lost. Shorter ones
+*   are padded with zeros up to the last page. The event must not be packed
+*   yet, so that peak and summary are then computed only over the samples
+*   actually stored.
+*
+* Parameters:  
+*   Log event pointer, number of pages.
 *
 * Return:
 *   None.
 *
 *******************************************************************************/
-void LOG_sendData(log_t* message)
+void LOG_fitEvent(log_event_t* event, uint8_t nPages)
+{
+    // Available payload bytes in the given pages
+    uint16_t max_bytes = nPages * LOG_MESSAGE_DATA_BYTE - LOG_EVENT_DESC_BYTE;
+    
+    // Find number of samples fitting the pages
+    uint8_t format = LOG_getPayloadFormat(event);
+    uint16_t samples = event->length / 3;
+    while ((samples > 0) && (LOG_getPackedLength(format, samples) > max_bytes))
+    {
+        samples--;
+    }
+    
+    // First row of the window kept around the trigger
+    uint16_t rows = event->length / 3;
+    uint16_t first = samples / LOG_FIT_PRE_TRIGGER_DIV;
+    first = (event->trigger > first) ? (event->trigger - first) : 0;
+    if (first + samples > rows)
+    {
+        first = rows - samples;
+    }
+    
+    // Move kept X, Y, Z rows to the head of the payload
+    memmove(event->data, &event->data[first * 3], samples * 3);
+    event->length = samples * 3;
+    
+    // Keep the part of the core window inside the payload
+    uint16_t core_start = (event->coreStart > first) ? event->coreStart : first;
+    uint16_t core_end = event->coreStart + event->coreLength;
+    core_end = (core_end < first + samples) ? core_end : (first + samples);
+    if (core_end > core_start)
+    {
+        event->coreStart = core_start - first;
+        event->coreLength = core_end - core_start;
+    }
+    else
+    {
+        event->coreStart = 0;
+        event->coreLength = 0;
+    }
+    
+    // Keep trigger sample inside the payload
+    event->trigger = (event->trigger > first) ? (event->trigger - first) : 0;
+    if ((samples > 0) && (event->trigger >= samples))
+    {
+        event->trigger = samples - 1;
+    }
+    
+    event->pages = nPages;
+}
+
+
+/*******************************************************************************
+* Function Name: LOG_getEventMessage
+********************************************************************************
+*
+* Summary:
+*   Create the n-th log type message of an event. The first message carries the
+*   event descriptor before the payload, the last ones are padded with zeros.
+*   The event must be packed and its page count and peak magnitude assigned
+*   before calling this function.
+*
+* Parameters:  
+*   Log event pointer, index of desired page.
+*
+* Return:
+*   Log type message.
+*
+*******************************************************************************/
+log_t LOG_getEventMessage(log_event_t* event, uint8_t pageIndex)
 {
-    // Unpack message inside buffer
-    uint8_t buffer[LOG_MESSAGE_TOT_BYTE];
-    LOG_unpackMessage(buffer, message);
+    uint8_t payload[LOG_MESSAGE_DATA_BYTE];
+    memset(payload, 0, LOG_MESSAGE_DATA_BYTE);
     
-    // Send buffer via UART
-    UART_PutArray(buffer, LOG_MESSAGE_TOT_BYTE);
+    // Offset of the page inside the payload stream (descriptor included)
+    int16_t offset = pageIndex * LOG_MESSAGE_DATA_BYTE - LOG_EVENT_DESC_BYTE;
+    uint8_t start = 0;
+    
+    // First page starts with event descriptor
+    if (pageIndex == 0)
+    {
+        payload[LOG_EVENT_DESC_PAGES] = event->pages;
+        payload[LOG_EVENT_DESC_LEN_LOW] = (event->length & 0xFF);
+        payload[LOG_EVENT_DESC_LEN_HIGH] = ((event->length >> 8) & 0xFF);
+        payload[LOG_EVENT_DESC_TRIGGER] = event->trigger;
+        payload[LOG_EVENT_DESC_PEAK_LOW] = (event->peak & 0xFF);
+        payload[LOG_EVENT_DESC_PEAK_HIGH] = ((event->peak >> 8) & 0xFF);
+        payload[LOG_EVENT_DESC_FORMAT] = event->format;
+        payload[LOG_EVENT_DESC_CORE_START] = event->coreStart;
+        payload[LOG_EVENT_DESC_CORE_LEN] = event->coreLength;
+        payload[LOG_EVENT_DESC_RATE] = (LOG_CONTEXT_DOWN_SAMPLE << 4) | LOG_CORE_DOWN_SAMPLE;
+        memcpy(&payload[LOG_EVENT_DESC_SUMMARY], event->summary, LOG_EVENT_SUMMARY_BYTE);
+        start = LOG_EVENT_DESC_BYTE;
+        offset = 0;
+    }
+    
+    // Copy valid payload bytes of this page
+    if (offset < event->length)
+    {
+        uint16_t n_bytes = event->length - offset;
+        if (n_bytes > LOG_MESSAGE_DATA_BYTE - start)
+        {
+            n_bytes = LOG_MESSAGE_DATA_BYTE - start;
+        }
+        memcpy(&payload[start], &event->data[offset], n_bytes);
+    }
+    
+    // Create log type message
+    return LOG_createMessage(event->logID, event->intReg, event->timestamp, payload);
 }
 
 /* [] END OF FILE */
@@ -16,6 +16,8 @@
     
     /* Project dependencies. */
     #include "project.h"
+    #include "LIS3DH.h"
+    #include "Trigger.h"
     
     /* Useful constants definition. */
     #define LOG_MESSAGE_HEADER_BYTE 4
@@ -24,6 +26,67 @@
     #define LOG_TICK_PER_SECOND     1000
     #define LOG_TIMER_OVERFLOW      0xFFFFFFFF
     
+    /* Event record constants. */
+    #define LOG_EVENT_DESC_BYTE     20
+    #define LOG_EVENT_DESC_PAGES    0
+    #define LOG_EVENT_DESC_LEN_LOW  1
+    #define LOG_EVENT_DESC_LEN_HIGH 2
+    #define LOG_EVENT_DESC_TRIGGER  3
+    #define LOG_EVENT_DESC_PEAK_LOW 4
+    #define LOG_EVENT_DESC_PEAK_HIGH 5
+    #define LOG_EVENT_DESC_FORMAT   6
+    #define LOG_EVENT_DESC_CORE_START 7
+    #define LOG_EVENT_DESC_CORE_LEN 8
+    #define LOG_EVENT_DESC_RATE     9
+    #define LOG_EVENT_DESC_SUMMARY  10
+    
+    /* Event summary constants (offsets inside the summary field of the descriptor). */
+    #define LOG_EVENT_SUMMARY_BYTE  10
+    #define LOG_EVENT_SUM_AXIS_PEAK 0
+    #define LOG_EVENT_SUM_TTP_LOW   3
+    #define LOG_EVENT_SUM_TTP_HIGH  4
+    #define LOG_EVENT_SUM_AXIS_RMS  5
+    #define LOG_EVENT_SUM_ABOVE_LOW 8
+    #define LOG_EVENT_SUM_ABOVE_HIGH 9
+    #define LOG_SAMPLE_PERIOD_MS    (1000 / LIS3DH_ODR_HZ)
+    #define LOG_EVENT_ABOVE_THS     LIS3DH_INT1_THS_VALUE // Same scale as 8-bit samples @ +-2G FSR
+    
+    /* Event payload format (mask of axes stored at full rate). */
+    #define LOG_EVENT_SPARSE_PAYLOAD 1
+    #define LOG_EVENT_FORMAT_X      0x01
+    #define LOG_EVENT_FORMAT_Y      0x02
+    #define LOG_EVENT_FORMAT_Z      0x04
+    #define LOG_EVENT_FORMAT_DENSE  0x07
+    #define LOG_EVENT_COARSE_RATIO  8
+    
+    /* Event capture settings (in FIFO of down-sampled data). */
+    #define LOG_PRE_TRIGGER_FIFO    2
+    #define LOG_POST_TRIGGER_FIFO   1
+    #define LOG_FIT_PRE_TRIGGER_DIV 4   // An event cut to fewer pages keeps 1/4 of its rows before the trigger
+    
+    /* Multi-resolution capture: trigger FIFO (core) at full rate, other FIFO (context) filtered and decimated. */
+    #define LOG_MULTI_RESOLUTION    1
+    #if (LOG_MULTI_RESOLUTION)
+        #define LOG_CORE_DOWN_SAMPLE    1
+    #else
+        #define LOG_CORE_DOWN_SAMPLE    LIS3DH_DOWN_SAMPLE
+    #endif
+    #define LOG_CONTEXT_DOWN_SAMPLE LIS3DH_DOWN_SAMPLE
+    #define LOG_CORE_ROWS_PER_FIFO  (LIS3DH_LEVELS_IN_FIFO / LOG_CORE_DOWN_SAMPLE)
+    #define LOG_CONTEXT_ROWS_PER_FIFO (LIS3DH_LEVELS_IN_FIFO / LOG_CONTEXT_DOWN_SAMPLE)
+    #define LOG_EVENT_MAX_DATA_BYTE 768
+    #define LOG_EVENT_MAX_FIFO      ((LOG_EVENT_MAX_DATA_BYTE / 3 - LOG_CORE_ROWS_PER_FIFO) / LOG_CONTEXT_ROWS_PER_FIFO + 1)
+    #define LOG_EVENT_MAX_PAGES     ((LOG_EVENT_DESC_BYTE + LOG_EVENT_MAX_DATA_BYTE + LOG_MESSAGE_DATA_BYTE - 1) / LOG_MESSAGE_DATA_BYTE)
+    #define LOG_EVENT_MAX_SAMPLES   (LOG_EVENT_MAX_DATA_BYTE / 3)
+    #define LOG_EVENT_MAX_COARSE    ((LOG_EVENT_MAX_SAMPLES + LOG_EVENT_COARSE_RATIO - 1) / LOG_EVENT_COARSE_RATIO)
+    #define LOG_EVENT_MIN_SAMPLES   ((LOG_PRE_TRIGGER_FIFO + LOG_POST_TRIGGER_FIFO - 1) * LOG_CONTEXT_ROWS_PER_FIFO + LOG_CORE_ROWS_PER_FIFO)
+    #if (LOG_EVENT_SPARSE_PAYLOAD)
+        #define LOG_EVENT_MIN_DATA_BYTE (LOG_EVENT_MIN_SAMPLES + 2 * ((LOG_EVENT_MIN_SAMPLES + LOG_EVENT_COARSE_RATIO - 1) / LOG_EVENT_COARSE_RATIO))
+    #else
+        #define LOG_EVENT_MIN_DATA_BYTE (LOG_EVENT_MIN_SAMPLES * 3)
+    #endif
+    #define LOG_EVENT_MIN_PAGES     ((LOG_EVENT_DESC_BYTE + LOG_EVENT_MIN_DATA_BYTE + LOG_MESSAGE_DATA_BYTE - 1) / LOG_MESSAGE_DATA_BYTE)
+    
     /* Log message type. */
     typedef struct {
         uint8_t logID;
@@ -32,13 +95,41 @@
         uint8_t data[LOG_MESSAGE_DATA_BYTE];
     } log_t;
     
+    /* Log event type, spread over multiple log messages once stored. */
+    typedef struct {
+        uint8_t logID;
+        uint8_t intReg;
+        uint16_t timestamp;
+        uint8_t trigger;
+        uint8_t pages;
+        uint16_t peak;
+        uint8_t format;
+        uint16_t samples;
+        uint8_t coreStart;
+        uint8_t coreLength;
+        uint16_t length;
+        uint8_t summary[LOG_EVENT_SUMMARY_BYTE];
+        uint8_t data[LOG_EVENT_MAX_DATA_BYTE];
+    } log_event_t;
+    
     /* Function prototype declaration. */
     log_t LOG_createMessage(uint8_t logID, uint8_t intReg, uint16_t time, uint8_t* dataPtr);  
     void LOG_insertPayload(log_t* msg, uint8_t* dataPtr);
     uint16_t LOG_getTimestamp(void); 
     void LOG_unpackMessage(uint8_t* buffer, log_t* message); 
     void LOG_packMessage(log_t* message, uint8_t* buffer);
-    void LOG_sendData(log_t* message);
+    
+    /* Event prototype declaration. */
+    void LOG_initEvent(log_event_t* event, uint8_t logID, uint8_t intReg, uint16_t time, uint8_t trigger);
+    uint8_t LOG_appendEvent(log_event_t* event, uint8_t* dataPtr, uint16_t nBytes);
+    uint8_t LOG_appendEventCore(log_event_t* event, uint8_t* dataPtr, uint16_t nBytes);
+    uint8_t LOG_getEventPages(log_event_t* event);
+    uint16_t LOG_getEventPeak(log_event_t* event);
+    void LOG_summarizeEvent(log_event_t* event);
+    uint8_t LOG_getEventFormat(uint8_t intReg);
+    void LOG_packEvent(log_event_t* event);
+    void LOG_fitEvent(log_event_t* event, uint8_t nPages);
+    log_t LOG_getEventMessage(log_event_t* event, uint8_t pageIndex);
     
 #endif
 
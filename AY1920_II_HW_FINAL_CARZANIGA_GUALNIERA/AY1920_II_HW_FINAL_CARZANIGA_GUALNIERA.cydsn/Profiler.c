@@ -0,0 +1,150 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * to profile code sections on the target.
+ *
+ * The DWT cycle counter of the Cortex-M3 is
+ * a free running 32-bit counter incremented
+ * at each CPU clock cycle, so the duration of
+ * a section is the difference between two
+ * readings (wrap-around included) and costs
+ * only two register reads.
+ *
+ * For each section the last, maximum and
+ * average number of cycles are kept, the
+ * average being refreshed every 64 runs.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Profiler.h"
+
+
+/* Cycle statistics of all sections. */
+static prof_stats_t prof_stats[PROF_SECTION_COUNT];
+
+
+/*******************************************************************************
+* Function Name: PROF_Init
+********************************************************************************
+*
+* Summary:
+*   Enable the DWT cycle counter and reset all statistics.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void PROF_Init(void)
+{
+    // Enable trace and debug blocks
+    CY_SET_REG32(PROF_DEMCR_ADDR, CY_GET_REG32(PROF_DEMCR_ADDR) | PROF_DEMCR_TRCENA);
+    
+    // Start cycle counter
+    CY_SET_REG32(PROF_DWT_CYCCNT_ADDR, 0);
+    CY_SET_REG32(PROF_DWT_CTRL_ADDR, CY_GET_REG32(PROF_DWT_CTRL_ADDR) | PROF_DWT_CTRL_CYCCNTENA);
+    
+    // Reset statistics
+    memset(prof_stats, 0, sizeof(prof_stats));
+}
+
+
+/*******************************************************************************
+* Function Name: PROF_start
+********************************************************************************
+*
+* Summary:
+*   Read cycle counter at the beginning of a section.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Current cycle counter value.
+*
+*******************************************************************************/
+uint32_t PROF_start(void)
+{
+    return CY_GET_REG32(PROF_DWT_CYCCNT_ADDR);
+}
+
+
+/*******************************************************************************
+* Function Name: PROF_stop
+********************************************************************************
+*
+* Summary:
+*   Read cycle counter at the end of a section and update its statistics.
+*
+* Parameters:  
+*   Profiled section, cycle counter value returned by PROF_start.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void PROF_stop(prof_section_t section, uint32_t start)
+{
+    // Elapsed cycles (unsigned difference handles wrap-around)
+    uint32_t cycles = CY_GET_REG32(PROF_DWT_CYCCNT_ADDR) - start;
+    prof_stats_t* stats = &prof_stats[section];
+    
+    stats->last = cycles;
+    if (cycles > stats->max)
+    {
+        stats->max = cycles;
+    }
+    
+    // Refresh average once the window is complete
+    stats->sum += cycles;
+    stats->count++;
+    if (stats->count >= PROF_AVERAGE_WINDOW)
+    {
+        stats->average = stats->sum / stats->count;
+        stats->sum = 0;
+        stats->count = 0;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: PROF_sendData
+********************************************************************************
+*
+* Summary:
+*   Send number of sections followed by last, maximum and average cycles of
+*   each section (32-bit little endian) over UART.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void PROF_sendData(void)
+{
+    SERIAL_PutCharWait(SERIAL_CHANNEL_CONTROL, PROF_SECTION_COUNT);
+    
+    for (uint8_t i=0; i<PROF_SECTION_COUNT; i++)
+    {
+        uint32_t values[3] = {prof_stats[i].last, prof_stats[i].max, prof_stats[i].average};
+        uint8_t buffer[PROF_SECTION_BYTE];
+        
+        for (uint8_t j=0; j<3; j++)
+        {
+            buffer[j*4] = values[j] & 0xFF;
+            buffer[j*4 + 1] = (values[j] >> 8) & 0xFF;
+            buffer[j*4 + 2] = (values[j] >> 16) & 0xFF;
+            buffer[j*4 + 3] = (values[j] >> 24) & 0xFF;
+        }
+        SERIAL_PutArrayWait(SERIAL_CHANNEL_CONTROL, buffer, PROF_SECTION_BYTE);
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,65 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes to measure execution
+ * time of code sections in CPU cycles with
+ * the Cortex-M3 DWT cycle counter.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __PROFILER_H__
+    
+    #define __PROFILER_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "Serial.h"
+    
+    /* Cortex-M3 debug registers. */
+    #define PROF_DEMCR_ADDR         0xE000EDFCu
+    #define PROF_DEMCR_TRCENA       0x01000000u
+    #define PROF_DWT_CTRL_ADDR      0xE0001000u
+    #define PROF_DWT_CTRL_CYCCNTENA 0x00000001u
+    #define PROF_DWT_CYCCNT_ADDR    0xE0001004u
+    
+    /* Useful constants definition. */
+    #define PROF_AVERAGE_WINDOW     64
+    #define PROF_SECTION_BYTE       12
+    
+    /* Profiled code sections. */
+    typedef enum {
+        PROF_DECIMATOR,
+        PROF_DSP_MEDIAN,
+        PROF_DSP_HIGHPASS,
+        PROF_DSP_LOWPASS,
+        PROF_DSP_AVERAGE,
+        PROF_DSP_ENVELOPE,
+        PROF_CORDIC,
+        PROF_TRIGGER,
+        PROF_SPECTRUM,
+        PROF_STATS,
+        PROF_CODEC,
+        PROF_SECTION_COUNT
+    } prof_section_t;
+    
+    /* Cycle statistics of a code section. */
+    typedef struct {
+        uint32_t last;
+        uint32_t max;
+        uint32_t average;
+        uint32_t sum;
+        uint16_t count;
+    } prof_stats_t;
+    
+    /* Function prototype declaration. */
+    void PROF_Init(void);
+    uint32_t PROF_start(void);
+    void PROF_stop(prof_section_t section, uint32_t start);
+    void PROF_sendData(void);
+    
+#endif
+
+/* [] END OF FILE */
@@ -9,7 +9,24 @@
  * 
  * -> START MODE: the driving of the LED
  *    is based on IMU data by mapping XYZ
- *    values to RGB values.
+ *    values to RGB values. The LED output
+ *    is only computed when a new FIFO is
+ *    read and filtered by the DSP chain,
+ *    and PWM compare registers are only
+ *    written when their value changes.
+ *    Each sample is mapped to a duty cycle
+ *    by a single load from a lookup table
+ *    built at compile time, which applies
+ *    dead zone, saturation and gamma
+ *    correction (linear duty cycles look
+ *    too bright at low intensity).
+ *    In blink mode the sample sets the
+ *    blink frequency instead: the PWM
+ *    period is reprogrammed with a fixed
+ *    flash length, so that the PWM blocks
+ *    toggle the LED without any CPU work.
+ *    RED and GREEN share the period of
+ *    PWM_RG, driven by the stronger axis.
  *
  * -> CONFIG MODE only the blue channel
  *    of the LED is driven and it is either
@@ -23,6 +40,55 @@
 /* Project dependencies. */
 #include "RGB_Driver.h"
 
+/* Compare values currently written to the PWMs (X, Y, Z order). */
+static uint8_t pwm_compare[3];
+
+#if (RGB_DRIVE_MODE == RGB_DRIVE_BLINK)
+    /* Periods currently written to PWM_RG and PWM_B. */
+    static uint8_t pwm_period[2];
+#endif
+
+/* Mapping of a table index to the normalized intensity n in [0, RANGE]. */
+#define RGB_LUT_RANGE       (RGB_LUT_MAX - RGB_LUT_MIN)
+#define RGB_LUT_ABS(i)      (((i) < 128) ? (i) : (256 - (i)))
+#define RGB_LUT_NORM(i)     ((RGB_LUT_ABS(i) <= RGB_LUT_MIN) ? 0ULL : \
+                             (RGB_LUT_ABS(i) >= RGB_LUT_MAX) ? (unsigned long long)RGB_LUT_RANGE : \
+                             (unsigned long long)(RGB_LUT_ABS(i) - RGB_LUT_MIN))
+
+/* Expand the table entries by blocks. */
+#define RGB_LUT_4(i)        RGB_LUT_ENTRY(i), RGB_LUT_ENTRY(i + 1), RGB_LUT_ENTRY(i + 2), RGB_LUT_ENTRY(i + 3)
+#define RGB_LUT_16(i)       RGB_LUT_4(i), RGB_LUT_4(i + 4), RGB_LUT_4(i + 8), RGB_LUT_4(i + 12)
+#define RGB_LUT_64(i)       RGB_LUT_16(i), RGB_LUT_16(i + 16), RGB_LUT_16(i + 32), RGB_LUT_16(i + 48)
+
+#if (RGB_DRIVE_MODE == RGB_DRIVE_BLINK)
+
+/* Period = TICK / f - 1, with f linear from MIN_HZ to MAX_HZ, 0 turns the channel off. */
+#define RGB_LUT_ENTRY(i)    ((RGB_LUT_ABS(i) <= RGB_LUT_MIN) ? 0 : \
+                             (uint8_t)((RGB_BLINK_TICK_HZ * RGB_LUT_RANGE) / \
+                             (RGB_BLINK_MIN_HZ * RGB_LUT_RANGE + \
+                              (RGB_BLINK_MAX_HZ - RGB_BLINK_MIN_HZ) * RGB_LUT_NORM(i)) - 1))
+
+/* Blink period of each int8 sample, indexed by its two's complement byte. */
+static const uint8_t rgb_period_lut[256] = {
+    RGB_LUT_64(0), RGB_LUT_64(64), RGB_LUT_64(128), RGB_LUT_64(192)
+};
+
+#else
+
+/* Duty cycle = PWM_CYCLE_LENGTH * (L*n + S*n^2 + C*n^3) / 100, with n normalized to [0, 1]. */
+#define RGB_LUT_ENTRY(i)    ((uint8_t)((PWM_CYCLE_LENGTH * \
+                             (RGB_GAMMA_LINEAR * RGB_LUT_NORM(i) * RGB_LUT_RANGE * RGB_LUT_RANGE + \
+                              RGB_GAMMA_SQUARE * RGB_LUT_NORM(i) * RGB_LUT_NORM(i) * RGB_LUT_RANGE + \
+                              RGB_GAMMA_CUBE * RGB_LUT_NORM(i) * RGB_LUT_NORM(i) * RGB_LUT_NORM(i))) / \
+                             (100ULL * RGB_LUT_RANGE * RGB_LUT_RANGE * RGB_LUT_RANGE)))
+
+/* Duty cycle of each int8 sample, indexed by its two's complement byte. */
+static const uint8_t rgb_duty_lut[256] = {
+    RGB_LUT_64(0), RGB_LUT_64(64), RGB_LUT_64(128), RGB_LUT_64(192)
+};
+
+#endif
+
 
 /*******************************************************************************
 * Function Name: RGB_Init
@@ -54,7 +120,19 @@ void RGB_Init(void)
         PWM_B_Start();
     }
     
-    // Turn LED off
+    #if (RGB_DRIVE_MODE == RGB_DRIVE_BLINK)
+        // Slow down PWM clock to the blink tick
+        PWM_CLOCK_SetDividerValue(RGB_PWM_SOURCE_HZ / RGB_BLINK_TICK_HZ);
+        
+        // Start from the slowest blink frequency
+        pwm_period[0] = rgb_period_lut[RGB_LUT_MIN + 1];
+        pwm_period[1] = rgb_period_lut[RGB_LUT_MIN + 1];
+        PWM_RG_WritePeriod(pwm_period[0]);
+        PWM_B_WritePeriod(pwm_period[1]);
+    #endif
+    
+    // Turn LED off, forcing all compare registers to be written
+    memset(pwm_compare, PWM_COMPARE_STOP + 1, sizeof(pwm_compare));
     RGB_Stop();
 }
 
@@ -75,23 +153,9 @@ void RGB_Init(void)
 *******************************************************************************/
 void RGB_Stop(void)
 {
-    // Turn off LED red channel 
-    if (PWM_RG_ReadCompare1() != PWM_COMPARE_STOP)
-    {
-        PWM_RG_WriteCompare1(PWM_COMPARE_STOP);
-    }
-    
-    // Turn off LED green channel 
-    if (PWM_RG_ReadCompare2() != PWM_COMPARE_STOP)
-    {
-        PWM_RG_WriteCompare2(PWM_COMPARE_STOP);
-    }
-    
-    // Turn off LED blue channel 
-    if (PWM_B_ReadCompare() != PWM_COMPARE_STOP)
-    {
-        PWM_B_WriteCompare(PWM_COMPARE_STOP);
-    }
+    // Turn off all LED channels (only if not already off)
+    uint8_t buffer[3] = {PWM_COMPARE_STOP, PWM_COMPARE_STOP, PWM_COMPARE_STOP};
+    PWM_Driver(buffer);
 }
 
 /*
@@ -107,13 +171,14 @@ void RGB_Stop(void)
 *
 * Summary:
 *   High level function that enable LED driving based on IMU data coming from 
-*   LIS3DH. Given a single FIFO of IMU data this function first compute the
-*   average in order to obtain a stable value, then process the data to map
-*   the whole working range of the RGB LED with the absolute value of the
-*   inertial measurements and finally drive the two PWMs.
+*   LIS3DH, to be called only when a new FIFO is read. Given a single FIFO of
+*   IMU data filtered by the DSP chain this function takes the most recent
+*   sample, then process the data to map the whole working range of the RGB LED
+*   with the absolute value of the inertial measurements and finally drive the
+*   two PWMs.
 *
 * Parameters:  
-*   IMU FIFO data pointer.
+*   Filtered FIFO data pointer (32 rows of 3 axis value X, Y, Z).
 *
 * Return:
 *   None.
@@ -121,11 +186,16 @@ void RGB_Stop(void)
 *******************************************************************************/
 void RGB_Driver(uint8_t* dataPtr)
 {   
-    // Apply moving average filter
-    Moving_Average(dataPtr, RGB_DataBuffer, 32);
+    // Take the most recent filtered sample
+    memcpy(RGB_DataBuffer, &dataPtr[(RGB_FIFO_LEVELS - 1) * 3], 3);
     
-    // Process IMU data in place
-    RGB_dataProcess(RGB_DataBuffer);
+    #if (RGB_DRIVE_MODE == RGB_DRIVE_BLINK)
+        // Set blink periods and get compare values in place
+        RGB_blinkProcess(RGB_DataBuffer);
+    #else
+        // Process IMU data in place
+        RGB_dataProcess(RGB_DataBuffer);
+    #endif
     
     // Set PWM compare values
     PWM_Driver(RGB_DataBuffer);
@@ -169,6 +239,8 @@ void RGB_sendFlagNotify(uint8_t flag)
 *   | Y value ->  BLUE channel |
 *   | Z value -> GREEN channel |
 *   +--------------------------+
+*   Compare registers are written only when their value changes, so calling
+*   this function with the same data costs no PWM access.
 *
 * Parameters:  
 *   Buffer data pointer.
@@ -180,13 +252,25 @@ void RGB_sendFlagNotify(uint8_t flag)
 void PWM_Driver(uint8* dataPtr)
 {
     // Set red channel PWM compare value
-    PWM_RG_WriteCompare1(dataPtr[0]);
+    if (pwm_compare[0] != dataPtr[0])
+    {
+        PWM_RG_WriteCompare1(dataPtr[0]);
+        pwm_compare[0] = dataPtr[0];
+    }
     
     // Set green channel PWM compare value
-    PWM_RG_WriteCompare2(dataPtr[2]);
+    if (pwm_compare[2] != dataPtr[2])
+    {
+        PWM_RG_WriteCompare2(dataPtr[2]);
+        pwm_compare[2] = dataPtr[2];
+    }
     
     //Set blue channel PWM compare value
-    PWM_B_WriteCompare(dataPtr[1]);
+    if (pwm_compare[1] != dataPtr[1])
+    {
+        PWM_B_WriteCompare(dataPtr[1]);
+        pwm_compare[1] = dataPtr[1];
+    }
 }
 
 
@@ -195,8 +279,8 @@ void PWM_Driver(uint8* dataPtr)
 ********************************************************************************
 *
 * Summary:
-*   Process IMU data in place to map full LED range. First the absolute value is
-*   computed and then is scaled by 2 to map the LED working range.
+*   Process IMU data in place to map full LED range. Absolute value, dead zone,
+*   saturation and gamma correction are all precomputed in the lookup table.
 *
 * Parameters:  
 *   Buffer data pointer.
@@ -207,89 +291,66 @@ void PWM_Driver(uint8* dataPtr)
 *******************************************************************************/
 void RGB_dataProcess(uint8_t* dataPtr)
 {   
-    // For all 3 channels
-    for (uint8_t i=0; i<3; i++)
-    {
-        // Take absolute value
-        dataPtr[i] = Absolute_Value(dataPtr[i]);
-        
-        // Avoid variable overflow
-        if (dataPtr[i] > 127)
-        {
-            dataPtr[i] = 127;
-        }
-        
-        // Multiply by 2 to use full range of uint8
-        dataPtr[i] *= 2;
-        
-        // Get negated value to drive common anode LED
-        dataPtr[i] = ((uint8_t)dataPtr[i]);
-    }
+    #if (RGB_DRIVE_MODE == RGB_DRIVE_INTENSITY)
+        // One table load for each channel
+        dataPtr[0] = rgb_duty_lut[dataPtr[0]];
+        dataPtr[1] = rgb_duty_lut[dataPtr[1]];
+        dataPtr[2] = rgb_duty_lut[dataPtr[2]];
+    #else
+        // Blink mode maps data in RGB_blinkProcess()
+        (void)dataPtr;
+    #endif
 }
 
 
 /*******************************************************************************
-* Function Name: RGB_dataProcess
+* Function Name: RGB_blinkProcess
 ********************************************************************************
 *
 * Summary:
-*   Given a window of IMU data (ordered X->Y->Z->X..) it computes the average of
-*   that window.
+*   Map IMU data to blink frequencies by reprogramming the PWM periods, then
+*   replace data in place with the compare values of the flashes. RED and GREEN
+*   share PWM_RG, so its period follows the stronger of X and Z axes. Periods
+*   are written only when changed: the PWM reloads the period register at
+*   terminal count only, so the current blink cycle always completes and the
+*   compare value (flash length) never changes while blinking, which keeps the
+*   output free of glitches.
 *
 * Parameters:  
-*   Buffer data pointer, Empty 3 bytes buffer to store result, Size of window.
+*   Buffer data pointer.
 *
 * Return:
 *   None.
 *
 *******************************************************************************/
-void Moving_Average(uint8_t* dataPtr, uint8_t* filtPtr, uint8_t windowSize)
+void RGB_blinkProcess(uint8_t* dataPtr)
 {
-    int16_t dataSum[3] = {0,0,0};
-    
-    // For all sample in window
-    for (uint8_t i=0; i<windowSize; i++)
-    {
-        // For all 3 channels
-        for (uint8_t j=0; j<3; j++)
+    #if (RGB_DRIVE_MODE == RGB_DRIVE_BLINK)
+        // One table load for each channel
+        uint8_t red = rgb_period_lut[dataPtr[0]];
+        uint8_t blue = rgb_period_lut[dataPtr[1]];
+        uint8_t green = rgb_period_lut[dataPtr[2]];
+        
+        // Shared red/green period from the stronger axis (shorter period)
+        uint8_t red_green = ((red == 0) || ((green != 0) && (green < red))) ? green : red;
+        
+        // Reprogram periods (only if changed and channel not off)
+        if ((red_green != 0) && (red_green != pwm_period[0]))
         {
-            // Sum the sample
-            int8_t tmp = dataPtr[1+i*6+j*2];
-            dataSum[j] += (int16_t)tmp;
+            PWM_RG_WritePeriod(red_green);
+            pwm_period[0] = red_green;
         }
-    }
-    
-    // For all 3 channels
-    for (uint8_t i=0; i<3; i++)
-    {
-        // Assign window average value
-        filtPtr[i] = (uint8_t)(dataSum[i]/windowSize);
-    }
-}
-
-
-/*******************************************************************************
-* Function Name: Absolute_Value
-********************************************************************************
-*
-* Summary:
-*   Light-weight function to get absolute value of int8_t variable without 
-*   conditional jumps by setting the sign bit to zero.
-*
-* Parameters:  
-*   8-bit raw value.
-*
-* Return:
-*   8-bit absolute value.
-*
-*******************************************************************************/
-uint8_t Absolute_Value(int8_t value)
-{
-    // Get sign bit
-    const int8_t mask = value >> 7;
-    
-    // Compute abs value
-    return (uint8_t)((value + mask) ^ mask);
+        if ((blue != 0) && (blue != pwm_period[1]))
+        {
+            PWM_B_WritePeriod(blue);
+            pwm_period[1] = blue;
+        }
+        
+        // Fixed flash length, off below dead zone
+        dataPtr[0] = (red != 0) ? RGB_BLINK_ON_TICKS : PWM_COMPARE_STOP;
+        dataPtr[1] = (blue != 0) ? RGB_BLINK_ON_TICKS : PWM_COMPARE_STOP;
+        dataPtr[2] = (green != 0) ? RGB_BLINK_ON_TICKS : PWM_COMPARE_STOP;
+    #endif
 }
 
 /* [] END OF FILE */
@@ -23,6 +23,26 @@
     /* Useful constants. */
     #define PWM_CYCLE_LENGTH    255
     #define PWM_COMPARE_STOP    0
+    #define RGB_FIFO_LEVELS     32
+    
+    /* Intensity mapping, built at compile time into a lookup table. */
+    #define RGB_LUT_MIN         2   // Dead zone: |sample| <= MIN turns the channel off
+    #define RGB_LUT_MAX         127 // Saturation: |sample| >= MAX gives full duty cycle
+    #define RGB_GAMMA_LINEAR    0   // Weights (percent) of the gamma polynomial
+    #define RGB_GAMMA_SQUARE    80  // (80% square + 20% cube ~ gamma 2.2)
+    #define RGB_GAMMA_CUBE      20
+    
+    /* LED driving mode: intensity (duty cycle) or blink frequency (period). */
+    #define RGB_DRIVE_INTENSITY 0
+    #define RGB_DRIVE_BLINK     1
+    #define RGB_DRIVE_MODE      RGB_DRIVE_BLINK
+    
+    /* Blink engine settings (PWM clock is slowed down to the blink tick). */
+    #define RGB_PWM_SOURCE_HZ   3000000 // IMO feeding PWM_CLOCK (see .cydwr)
+    #define RGB_BLINK_TICK_HZ   500 // PWM counter clock in blink mode
+    #define RGB_BLINK_MIN_HZ    2   // Blink frequency at RGB_LUT_MIN
+    #define RGB_BLINK_MAX_HZ    16  // Blink frequency at RGB_LUT_MAX
+    #define RGB_BLINK_ON_TICKS  10  // Flash length: 20 ms
     
     /* LED driver value. */
     uint8_t RGB_DataBuffer[3];
@@ -34,8 +54,7 @@
     void RGB_sendFlagNotify(uint8_t flag);
     void PWM_Driver(uint8* dataPtr);
     void RGB_dataProcess(uint8_t* dataPtr);
-    void Moving_Average(uint8_t* dataPtr, uint8_t* filtPtr, uint8_t windowSize);
-    uint8_t Absolute_Value(int8_t value);
+    void RGB_blinkProcess(uint8_t* dataPtr);
     
 #endif    
 
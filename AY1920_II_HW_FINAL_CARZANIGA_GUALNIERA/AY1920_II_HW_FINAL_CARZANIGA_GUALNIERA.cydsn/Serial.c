@@ -0,0 +1,671 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the software TX ring buffers of the UART.
+ *
+ * Every logical channel (command responses,
+ * bulk downloads, live stream, event
+ * notifications) has its own
+ * ring buffer. Writers copy their bytes inside
+ * the ring of their channel and return
+ * immediately, while a scheduler moves blocks
+ * of bytes of one channel at time into the 4
+ * bytes hardware FIFO of the UART:
+ *
+ *   control --> [ ring ] --+
+ *   bulk    --> [ ring ] --+
+ *   stream  --> [ ring ] --+--> frame --> TX FIFO
+ *   event   --> [ ring ] --+
+ *
+ * -> The channel with the lowest priority
+ *    value holding data is served first, and
+ *    channels with the same priority share the
+ *    line in proportion to their share, so a
+ *    download and the stream run together and
+ *    a command response is never queued
+ *    behind them.
+ *
+ * -> In multiplexed link mode each block is
+ *    sent inside a frame (sync, channel,
+ *    length, payload, CRC-16), so that the
+ *    host can split channels again. In raw
+ *    mode blocks are sent as they are and a
+ *    channel is served until its ring is
+ *    empty, so that packets are never cut (as
+ *    needed by the Bridge Control Panel).
+ *
+ * -> With the UART TX interrupt available
+ *    the FIFO not full interrupt drains the
+ *    rings, and it is masked once they are
+ *    empty. Otherwise the main loop pumps
+ *    them at every iteration, without waiting.
+ *
+ * Non-blocking writes are all-or-nothing, so
+ * that a packet is never cut: if it does not
+ * fit the free space it is dropped (and
+ * counted) or the writer waits, depending on
+ * SERIAL_POLICY. Command responses always
+ * wait, since the host is counting their
+ * bytes.
+ *
+ * Bulk transfers can also fill the free space
+ * of a ring in place (claim, then commit),
+ * so that data read from the EEPROM is never
+ * copied before being sent.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Serial.h"
+
+
+/* Ring buffer of a logical channel. */
+typedef struct {
+    uint8_t* buffer;
+    uint16_t mask;
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile uint16_t count;
+    int16_t credit;
+} serial_channel_t;
+
+/* Ring buffers of all channels. */
+static uint8_t serial_control_buffer[SERIAL_CONTROL_SIZE];
+static uint8_t serial_bulk_buffer[SERIAL_BULK_SIZE];
+static uint8_t serial_stream_buffer[SERIAL_STREAM_SIZE];
+static uint8_t serial_event_buffer[SERIAL_EVENT_SIZE];
+static serial_channel_t serial_channels[SERIAL_CHANNELS];
+
+/* Scheduling of the channels. */
+static const uint8_t serial_priority[SERIAL_CHANNELS] = {SERIAL_CONTROL_PRIORITY, SERIAL_BULK_PRIORITY, SERIAL_STREAM_PRIORITY, SERIAL_EVENT_PRIORITY};
+static const uint8_t serial_share[SERIAL_CHANNELS] = {SERIAL_CONTROL_SHARE, SERIAL_BULK_SHARE, SERIAL_STREAM_SHARE, SERIAL_EVENT_SHARE};
+static uint8_t serial_raw_channel;
+
+/* Frame under transmission. */
+static uint8_t serial_frame[SERIAL_LINK_FRAME_BYTE];
+static uint16_t serial_frame_length;
+static uint16_t serial_frame_index;
+static uint8_t serial_link_mode;
+
+/* Ring buffer counters. */
+static uint32_t serial_dropped_bytes;
+static uint16_t serial_dropped_writes;
+static uint16_t serial_peak_count;
+
+
+/*******************************************************************************
+* Function Name: SERIAL_Init
+********************************************************************************
+*
+* Summary:
+*   Empty all ring buffers, select raw link mode and reset all counters.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void SERIAL_Init(void)
+{
+    uint8_t* buffers[SERIAL_CHANNELS] = {serial_control_buffer, serial_bulk_buffer, serial_stream_buffer, serial_event_buffer};
+    uint16_t sizes[SERIAL_CHANNELS] = {SERIAL_CONTROL_SIZE, SERIAL_BULK_SIZE, SERIAL_STREAM_SIZE, SERIAL_EVENT_SIZE};
+    
+    for (uint8_t ch=0; ch<SERIAL_CHANNELS; ch++)
+    {
+        serial_channels[ch].buffer = buffers[ch];
+        serial_channels[ch].mask = sizes[ch] - 1;
+        serial_channels[ch].head = 0;
+        serial_channels[ch].tail = 0;
+        serial_channels[ch].count = 0;
+        serial_channels[ch].credit = 0;
+    }
+    serial_raw_channel = SERIAL_CHANNEL_CONTROL;
+    
+    // Nothing under transmission
+    serial_frame_length = 0;
+    serial_frame_index = 0;
+    serial_link_mode = SERIAL_LINK_RAW;
+    
+    serial_dropped_bytes = 0;
+    serial_dropped_writes = 0;
+    serial_peak_count = 0;
+
+#if (SERIAL_TX_INTERRUPT)
+    // Interrupt is unmasked when there is something to send
+    UART_SetTxInterruptMode(0);
+#endif
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_selectChannel
+********************************************************************************
+*
+* Summary:
+*   Select the channel to be served next: among channels holding data with the
+*   lowest priority value, the one with the most credit. Credits are refilled
+*   by the channel share once all of them are spent, and they are cleared when
+*   the ring is empty so that an idle channel does not save bandwidth.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Channel index, SERIAL_CHANNELS if all rings are empty.
+*
+*******************************************************************************/
+static uint8_t SERIAL_selectChannel(void)
+{
+    // Highest priority holding data
+    uint8_t priority = UINT8_MAX;
+    for (uint8_t ch=0; ch<SERIAL_CHANNELS; ch++)
+    {
+        if (serial_channels[ch].count == 0)
+        {
+            serial_channels[ch].credit = 0;
+        }
+        else if (serial_priority[ch] < priority)
+        {
+            priority = serial_priority[ch];
+        }
+    }
+    if (priority == UINT8_MAX)
+    {
+        return SERIAL_CHANNELS;
+    }
+    
+    for (uint8_t round=0; round<2; round++)
+    {
+        // Channel with the most credit left
+        uint8_t selected = SERIAL_CHANNELS;
+        for (uint8_t ch=0; ch<SERIAL_CHANNELS; ch++)
+        {
+            if ((serial_channels[ch].count > 0) && (serial_priority[ch] == priority) && (serial_channels[ch].credit > 0) &&
+                ((selected == SERIAL_CHANNELS) || (serial_channels[ch].credit > serial_channels[selected].credit)))
+            {
+                selected = ch;
+            }
+        }
+        if (selected != SERIAL_CHANNELS)
+        {
+            return selected;
+        }
+        
+        // All credits spent, start a new round
+        for (uint8_t ch=0; ch<SERIAL_CHANNELS; ch++)
+        {
+            if ((serial_channels[ch].count > 0) && (serial_priority[ch] == priority))
+            {
+                serial_channels[ch].credit += serial_share[ch] * SERIAL_LINK_PAYLOAD;
+            }
+        }
+    }
+    
+    return SERIAL_CHANNELS;
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_nextFrame
+********************************************************************************
+*
+* Summary:
+*   Move the next block of bytes from the selected channel ring into the frame
+*   buffer, adding sync, channel, length and CRC in multiplexed link mode.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   1 if a frame is ready to be sent, 0 if all rings are empty.
+*
+*******************************************************************************/
+static uint8_t SERIAL_nextFrame(void)
+{
+    uint8_t ch;
+    
+    // Raw mode keeps serving a channel until its ring is empty
+    if ((serial_link_mode == SERIAL_LINK_RAW) && (serial_channels[serial_raw_channel].count > 0))
+    {
+        ch = serial_raw_channel;
+    }
+    else
+    {
+        ch = SERIAL_selectChannel();
+        if (ch == SERIAL_CHANNELS)
+        {
+            return 0;
+        }
+        serial_raw_channel = ch;
+    }
+    
+    serial_channel_t* channel = &serial_channels[ch];
+    uint16_t n_bytes = (channel->count < SERIAL_LINK_PAYLOAD) ? channel->count : SERIAL_LINK_PAYLOAD;
+    uint16_t offset = (serial_link_mode == SERIAL_LINK_MUX) ? SERIAL_LINK_HEADER_BYTE : 0;
+    
+    // Copy at most two chunks around the end of the ring
+    uint16_t first = channel->mask + 1 - channel->tail;
+    if (first > n_bytes)
+    {
+        first = n_bytes;
+    }
+    memcpy(&serial_frame[offset], &channel->buffer[channel->tail], first);
+    memcpy(&serial_frame[offset + first], channel->buffer, n_bytes - first);
+    channel->tail = (channel->tail + n_bytes) & channel->mask;
+    channel->count -= n_bytes;
+    channel->credit -= n_bytes;
+    
+    serial_frame_index = 0;
+    serial_frame_length = n_bytes;
+    
+    if (serial_link_mode == SERIAL_LINK_MUX)
+    {
+        // Header and CRC around the payload
+        serial_frame[0] = SERIAL_LINK_SYNC_0;
+        serial_frame[1] = SERIAL_LINK_SYNC_1;
+        serial_frame[2] = ch;
+        serial_frame[3] = n_bytes;
+        uint16_t crc = CRC_update(CRC_INIT, &serial_frame[2], n_bytes + 2);
+        serial_frame[SERIAL_LINK_HEADER_BYTE + n_bytes] = crc & 0xFF;
+        serial_frame[SERIAL_LINK_HEADER_BYTE + n_bytes + 1] = (crc >> 8) & 0xFF;
+        serial_frame_length += SERIAL_LINK_HEADER_BYTE + SERIAL_LINK_CRC_BYTE;
+    }
+    
+    return 1;
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_Pump
+********************************************************************************
+*
+* Summary:
+*   Move bytes from the ring buffers into the UART TX FIFO, one frame at time,
+*   until the FIFO is full or all rings are empty. It never waits for the line.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void SERIAL_Pump(void)
+{
+    uint8_t int_status = CyEnterCriticalSection();
+    
+    // Fill up hardware FIFO
+    while (UART_ReadTxStatus() & UART_TX_STS_FIFO_NOT_FULL)
+    {
+        // Get next frame once the current one is sent
+        if ((serial_frame_index >= serial_frame_length) && (SERIAL_nextFrame() == 0))
+        {
+            break;
+        }
+        UART_TXDATA_REG = serial_frame[serial_frame_index++];
+    }
+
+#if (SERIAL_TX_INTERRUPT)
+    // Mask FIFO not full interrupt once everything is sent
+    if (serial_frame_index >= serial_frame_length)
+    {
+        uint16_t queued = 0;
+        for (uint8_t ch=0; ch<SERIAL_CHANNELS; ch++)
+        {
+            queued += serial_channels[ch].count;
+        }
+        if (queued == 0)
+        {
+            UART_SetTxInterruptMode(0);
+        }
+    }
+#endif
+
+    CyExitCriticalSection(int_status);
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_setLinkMode
+********************************************************************************
+*
+* Summary:
+*   Select raw or multiplexed link mode. The frame under transmission is
+*   completed with the previous mode.
+*
+* Parameters:  
+*   Link mode.
+*
+* Return:
+*   Applied link mode.
+*
+*******************************************************************************/
+uint8_t SERIAL_setLinkMode(uint8_t mode)
+{
+    serial_link_mode = (mode == SERIAL_LINK_MUX) ? SERIAL_LINK_MUX : SERIAL_LINK_RAW;
+    return serial_link_mode;
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_getLinkMode
+********************************************************************************
+*
+* Summary:
+*   Get current link mode.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Link mode.
+*
+*******************************************************************************/
+uint8_t SERIAL_getLinkMode(void)
+{
+    return serial_link_mode;
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_queued
+********************************************************************************
+*
+* Summary:
+*   Update usage counters after bytes have been queued inside a ring buffer
+*   and let the UART send them. It must be called inside a critical section.
+*
+* Parameters:  
+*   Channel pointer, number of bytes.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void SERIAL_queued(serial_channel_t* channel, uint16_t nBytes)
+{
+    channel->head = (channel->head + nBytes) & channel->mask;
+    channel->count += nBytes;
+    
+    // Keep maximum usage of all rings
+    uint16_t queued = 0;
+    for (uint8_t ch=0; ch<SERIAL_CHANNELS; ch++)
+    {
+        queued += serial_channels[ch].count;
+    }
+    if (queued > serial_peak_count)
+    {
+        serial_peak_count = queued;
+    }
+
+#if (SERIAL_TX_INTERRUPT)
+    // Let the FIFO not full interrupt drain the rings
+    UART_SetTxInterruptMode(UART_TX_STS_FIFO_NOT_FULL);
+#endif
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_write
+********************************************************************************
+*
+* Summary:
+*   Copy bytes inside the ring buffer of a channel if all of them fit the free
+*   space.
+*
+* Parameters:  
+*   Channel, data pointer, number of bytes.
+*
+* Return:
+*   1 if bytes have been queued, 0 otherwise.
+*
+*******************************************************************************/
+static uint8_t SERIAL_write(uint8_t channel, const uint8_t* dataPtr, uint16_t nBytes)
+{
+    serial_channel_t* ring = &serial_channels[channel];
+    uint8_t int_status = CyEnterCriticalSection();
+    
+    if (nBytes > ring->mask + 1 - ring->count)
+    {
+        CyExitCriticalSection(int_status);
+        return 0;
+    }
+    
+    // Copy at most two chunks around the end of the ring
+    uint16_t first = ring->mask + 1 - ring->head;
+    if (first > nBytes)
+    {
+        first = nBytes;
+    }
+    memcpy(&ring->buffer[ring->head], dataPtr, first);
+    memcpy(ring->buffer, &dataPtr[first], nBytes - first);
+    SERIAL_queued(ring, nBytes);
+    
+    CyExitCriticalSection(int_status);
+    return 1;
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_PutArray
+********************************************************************************
+*
+* Summary:
+*   Queue bytes to be sent over a channel without waiting. If they do not fit
+*   the ring buffer they are dropped as a whole, unless the backpressure policy
+*   is selected.
+*
+* Parameters:  
+*   Channel, data pointer, number of bytes.
+*
+* Return:
+*   1 if bytes have been queued, 0 if they have been dropped.
+*
+*******************************************************************************/
+uint8_t SERIAL_PutArray(uint8_t channel, const uint8_t* dataPtr, uint16_t nBytes)
+{
+#if (SERIAL_POLICY == SERIAL_POLICY_BLOCK)
+    SERIAL_PutArrayWait(channel, dataPtr, nBytes);
+    return 1;
+#else
+    // Start sending what is already queued
+    SERIAL_Pump();
+    
+    if (SERIAL_write(channel, dataPtr, nBytes) == 0)
+    {
+        // Count dropped bytes
+        serial_dropped_bytes += nBytes;
+        serial_dropped_writes++;
+        return 0;
+    }
+    
+    SERIAL_Pump();
+    return 1;
+#endif
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_PutChar
+********************************************************************************
+*
+* Summary:
+*   Queue a single byte to be sent over a channel without waiting.
+*
+* Parameters:  
+*   Channel, byte to be sent.
+*
+* Return:
+*   1 if the byte has been queued, 0 if it has been dropped.
+*
+*******************************************************************************/
+uint8_t SERIAL_PutChar(uint8_t channel, uint8_t dataByte)
+{
+    return SERIAL_PutArray(channel, &dataByte, 1);
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_PutArrayWait
+********************************************************************************
+*
+* Summary:
+*   Queue bytes to be sent over a channel, pumping the ring buffers until there
+*   is enough room for them. Arrays longer than the ring are split in chunks.
+*
+* Parameters:  
+*   Channel, data pointer, number of bytes.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void SERIAL_PutArrayWait(uint8_t channel, const uint8_t* dataPtr, uint16_t nBytes)
+{
+    uint16_t size = serial_channels[channel].mask + 1;
+    
+    while (nBytes > 0)
+    {
+        uint16_t chunk = (nBytes > size) ? size : nBytes;
+        
+        // Wait for the line to free enough space
+        while (SERIAL_write(channel, dataPtr, chunk) == 0)
+        {
+            SERIAL_Pump();
+        }
+        SERIAL_Pump();
+        
+        dataPtr += chunk;
+        nBytes -= chunk;
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_PutCharWait
+********************************************************************************
+*
+* Summary:
+*   Queue a single byte to be sent over a channel, waiting for room if needed.
+*
+* Parameters:  
+*   Channel, byte to be sent.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void SERIAL_PutCharWait(uint8_t channel, uint8_t dataByte)
+{
+    SERIAL_PutArrayWait(channel, &dataByte, 1);
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_getFree
+********************************************************************************
+*
+* Summary:
+*   Get number of free bytes inside the ring buffer of a channel.
+*
+* Parameters:  
+*   Channel.
+*
+* Return:
+*   Number of free bytes.
+*
+*******************************************************************************/
+uint16_t SERIAL_getFree(uint8_t channel)
+{
+    return serial_channels[channel].mask + 1 - serial_channels[channel].count;
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_claim
+********************************************************************************
+*
+* Summary:
+*   Get the contiguous free space at the head of the ring buffer of a channel,
+*   so that it can be filled in place. Bytes are sent only once committed, and
+*   no other write to the channel must occur in between.
+*
+* Parameters:  
+*   Channel, pointer to the first free byte (output).
+*
+* Return:
+*   Number of contiguous free bytes.
+*
+*******************************************************************************/
+uint16_t SERIAL_claim(uint8_t channel, uint8_t** dataPtr)
+{
+    serial_channel_t* ring = &serial_channels[channel];
+    *dataPtr = &ring->buffer[ring->head];
+    
+    // Free space stops at the tail or at the end of the ring
+    uint16_t free = ring->mask + 1 - ring->count;
+    uint16_t contiguous = ring->mask + 1 - ring->head;
+    
+    return (free < contiguous) ? free : contiguous;
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_commit
+********************************************************************************
+*
+* Summary:
+*   Queue bytes written in place after SERIAL_claim() to be sent over a channel.
+*
+* Parameters:  
+*   Channel, number of bytes written.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void SERIAL_commit(uint8_t channel, uint16_t nBytes)
+{
+    uint8_t int_status = CyEnterCriticalSection();
+    SERIAL_queued(&serial_channels[channel], nBytes);
+    CyExitCriticalSection(int_status);
+    
+    SERIAL_Pump();
+}
+
+
+/*******************************************************************************
+* Function Name: SERIAL_sendStatus
+********************************************************************************
+*
+* Summary:
+*   Send ring buffer counters over the control channel: dropped bytes, dropped
+*   writes and maximum number of bytes queued in all rings (little endian).
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void SERIAL_sendStatus(void)
+{
+    uint8_t status[SERIAL_STATUS_BYTE];
+    status[0] = serial_dropped_bytes & 0xFF;
+    status[1] = (serial_dropped_bytes >> 8) & 0xFF;
+    status[2] = (serial_dropped_bytes >> 16) & 0xFF;
+    status[3] = (serial_dropped_bytes >> 24) & 0xFF;
+    status[4] = serial_dropped_writes & 0xFF;
+    status[5] = (serial_dropped_writes >> 8) & 0xFF;
+    status[6] = serial_peak_count & 0xFF;
+    status[7] = (serial_peak_count >> 8) & 0xFF;
+    
+    SERIAL_PutArrayWait(SERIAL_CHANNEL_CONTROL, status, SERIAL_STATUS_BYTE);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,86 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the software TX
+ * ring buffers placed in front of the UART,
+ * one for each logical channel, so that
+ * writers never wait for the line.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __SERIAL_H__
+
+    #define __SERIAL_H__
+
+    /* Project dependencies. */
+    #include "project.h"
+    #include "CRC.h"
+
+    /* Logical channels sharing the UART. */
+    #define SERIAL_CHANNEL_CONTROL  0   // Responses of short commands
+    #define SERIAL_CHANNEL_BULK     1   // Log, catalog, statistics and image downloads
+    #define SERIAL_CHANNEL_STREAM   2   // Live IMU stream
+    #define SERIAL_CHANNEL_EVENT    3   // Notifications of stored events
+    #define SERIAL_CHANNELS         4
+
+    /* Ring buffer size of each channel (power of 2). */
+    #define SERIAL_CONTROL_SIZE     256
+    #define SERIAL_BULK_SIZE        1024
+    #define SERIAL_STREAM_SIZE      1024
+    #define SERIAL_EVENT_SIZE       64
+
+    /* Scheduling of the channels: lower priority value is served first, channels
+       with the same priority share the line in proportion to their share. */
+    #define SERIAL_CONTROL_PRIORITY 0
+    #define SERIAL_BULK_PRIORITY    1
+    #define SERIAL_STREAM_PRIORITY  1
+    #define SERIAL_EVENT_PRIORITY   0
+    #define SERIAL_CONTROL_SHARE    1
+    #define SERIAL_BULK_SHARE       1
+    #define SERIAL_STREAM_SHARE     1
+    #define SERIAL_EVENT_SHARE      1
+
+    /* Link layer frame: sync, channel, length, payload, CRC-16 of channel, length and payload. */
+    #define SERIAL_LINK_RAW         0   // Channel bytes sent as they are (Bridge Control Panel)
+    #define SERIAL_LINK_MUX         1   // Channel bytes sent inside link frames
+    #define SERIAL_LINK_SYNC_0      0xA5
+    #define SERIAL_LINK_SYNC_1      0x3C
+    #define SERIAL_LINK_HEADER_BYTE 4
+    #define SERIAL_LINK_CRC_BYTE    2
+    #define SERIAL_LINK_PAYLOAD     128 // Maximum payload of a frame
+    #define SERIAL_LINK_FRAME_BYTE  (SERIAL_LINK_HEADER_BYTE + SERIAL_LINK_PAYLOAD + SERIAL_LINK_CRC_BYTE)
+
+    #define SERIAL_STATUS_BYTE      8
+
+    /* Policy of non-blocking writes not fitting the ring buffer. */
+    #define SERIAL_POLICY_DROP      0
+    #define SERIAL_POLICY_BLOCK     1
+    #define SERIAL_POLICY           SERIAL_POLICY_DROP
+
+    /* Drain by the UART TX interrupt when the component has one (TX buffer size > 4), otherwise from the main loop. */
+    #if defined(UART_TX_VECT_NUM)
+        #define SERIAL_TX_INTERRUPT 1
+    #else
+        #define SERIAL_TX_INTERRUPT 0
+    #endif
+
+    /* Function prototype declaration. */
+    void SERIAL_Init(void);
+    void SERIAL_Pump(void);
+    uint8_t SERIAL_setLinkMode(uint8_t mode);
+    uint8_t SERIAL_getLinkMode(void);
+    uint8_t SERIAL_PutArray(uint8_t channel, const uint8_t* dataPtr, uint16_t nBytes);
+    uint8_t SERIAL_PutChar(uint8_t channel, uint8_t dataByte);
+    void SERIAL_PutArrayWait(uint8_t channel, const uint8_t* dataPtr, uint16_t nBytes);
+    void SERIAL_PutCharWait(uint8_t channel, uint8_t dataByte);
+    uint16_t SERIAL_getFree(uint8_t channel);
+    uint16_t SERIAL_claim(uint8_t channel, uint8_t** dataPtr);
+    void SERIAL_commit(uint8_t channel, uint16_t nBytes);
+    void SERIAL_sendStatus(void);
+
+#endif
+
+/* [] END OF FILE */
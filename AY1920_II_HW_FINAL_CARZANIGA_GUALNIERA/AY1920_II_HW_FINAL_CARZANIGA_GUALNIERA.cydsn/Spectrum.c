@@ -0,0 +1,291 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the fixed-point spectral analysis.
+ *
+ * Each new FIFO is a 32 samples window of
+ * each axis, which goes through:
+ *
+ *  x -> [-mean] -> [Hann window] -> [radix-2 FFT] -> |X[k]|
+ *    -> [max over 2 bins] -> band amplitude
+ *
+ * -> The FFT is computed in place with int16
+ *    values and Q15 twiddle factors, scaled
+ *    by 1/2 on every stage so that it never
+ *    overflows.
+ *
+ * -> Magnitudes of the complex bins are
+ *    computed by the CORDIC kernel, then
+ *    converted to the amplitude in LSB of a
+ *    sine wave at that frequency.
+ *
+ * -> The DC bin (gravity) is discarded and
+ *    bins 1-16 (6.25-100 Hz) are grouped into
+ *    8 bands of 12.5 Hz.
+ *
+ * Band amplitudes are averaged over 4 FIFO
+ * before being streamed: 24 bytes every 0.64s
+ * instead of 640 bytes of raw samples.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Spectrum.h"
+
+
+/* Hann window in Q15. */
+static const int16_t spec_window[SPEC_FFT_SIZE] = {
+    0, 315, 1247, 2761, 4799, 7281, 10114, 13187,
+    16383, 19580, 22653, 25486, 27968, 30006, 31520, 32452,
+    32767, 32452, 31520, 30006, 27968, 25486, 22653, 19580,
+    16384, 13187, 10114, 7281, 4799, 2761, 1247, 315
+};
+
+/* Twiddle factors cos(2*pi*k/N) and sin(2*pi*k/N) in Q15. */
+static const int16_t spec_cos[SPEC_FFT_SIZE / 2] = {
+    32767, 32137, 30273, 27245, 23170, 18204, 12539, 6393,
+    0, -6393, -12539, -18204, -23170, -27245, -30273, -32137
+};
+static const int16_t spec_sin[SPEC_FFT_SIZE / 2] = {
+    0, 6393, 12539, 18204, 23170, 27245, 30273, 32137,
+    32767, 32137, 30273, 27245, 23170, 18204, 12539, 6393
+};
+
+/* Band amplitudes of the last FIFO and their sums over the averaging window. */
+static uint8_t spec_bands[SPEC_BANDS][3];
+static uint16_t spec_band_sum[SPEC_BANDS][3];
+static uint8_t spec_fifo_count;
+
+
+/*******************************************************************************
+* Function Name: SPEC_Init
+********************************************************************************
+*
+* Summary:
+*   Reset band amplitudes and averaging window.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void SPEC_Init(void)
+{
+    memset(spec_bands, 0, sizeof(spec_bands));
+    memset(spec_band_sum, 0, sizeof(spec_band_sum));
+    spec_fifo_count = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: SPEC_fft
+********************************************************************************
+*
+* Summary:
+*   In place radix-2 decimation in time FFT, scaled by 1/N.
+*
+* Parameters:  
+*   Real and imaginary parts of the window.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void SPEC_fft(int16_t* re, int16_t* im)
+{
+    // Bit reversal permutation
+    for (uint8_t i=1, j=0; i<SPEC_FFT_SIZE; i++)
+    {
+        uint8_t bit = SPEC_FFT_SIZE >> 1;
+        while (j & bit)
+        {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+        
+        if (i < j)
+        {
+            int16_t tmp = re[i];
+            re[i] = re[j];
+            re[j] = tmp;
+            tmp = im[i];
+            im[i] = im[j];
+            im[j] = tmp;
+        }
+    }
+    
+    // Butterflies, scaled by 1/2 on every stage
+    for (uint8_t half=1; half<SPEC_FFT_SIZE; half<<=1)
+    {
+        uint8_t step = SPEC_FFT_SIZE / (2 * half);
+        for (uint8_t k=0; k<half; k++)
+        {
+            // Twiddle factor W = cos - j*sin
+            int32_t wr = spec_cos[k * step];
+            int32_t wi = -spec_sin[k * step];
+            
+            for (uint8_t i=k; i<SPEC_FFT_SIZE; i+=2*half)
+            {
+                uint8_t j = i + half;
+                int32_t tr = (wr * re[j] - wi * im[j]) >> 15;
+                int32_t ti = (wr * im[j] + wi * re[j]) >> 15;
+                re[j] = (int16_t)((re[i] - tr) >> 1);
+                im[j] = (int16_t)((im[i] - ti) >> 1);
+                re[i] = (int16_t)((re[i] + tr) >> 1);
+                im[i] = (int16_t)((im[i] + ti) >> 1);
+            }
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: SPEC_Process
+********************************************************************************
+*
+* Summary:
+*   Compute band amplitudes of each axis from a new FIFO of IMU data and add
+*   them to the averaging window.
+*
+* Parameters:  
+*   Raw FIFO data (32 levels of X, Y, Z low and high registers).
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void SPEC_Process(uint8_t* rawData)
+{
+    uint32_t start = PROF_start();
+    
+    // Restart averaging window if last one was not sent
+    if (spec_fifo_count >= SPEC_AVERAGE_FIFO)
+    {
+        memset(spec_band_sum, 0, sizeof(spec_band_sum));
+        spec_fifo_count = 0;
+    }
+    
+    for (uint8_t axis=0; axis<3; axis++)
+    {
+        int16_t re[SPEC_FFT_SIZE];
+        int16_t im[SPEC_FFT_SIZE];
+        
+        // Mean of the window (gravity), removed so that it does not leak into band 0
+        int16_t mean = 0;
+        for (uint8_t i=0; i<SPEC_FFT_SIZE; i++)
+        {
+            mean += (int8_t)rawData[i*LIS3DH_FIFO_BYTES_IN_LEVEL + axis*2 + 1];
+        }
+        mean = (mean * 128) / SPEC_FFT_SIZE;
+        
+        // Load windowed high registers (x * 128)
+        for (uint8_t i=0; i<SPEC_FFT_SIZE; i++)
+        {
+            int32_t x = (int8_t)rawData[i*LIS3DH_FIFO_BYTES_IN_LEVEL + axis*2 + 1] * 128 - mean;
+            re[i] = (int16_t)((x * spec_window[i]) >> 15);
+            im[i] = 0;
+        }
+        
+        SPEC_fft(re, im);
+        
+        // Peak amplitude of each band, skipping DC
+        for (uint8_t b=0; b<SPEC_BANDS; b++)
+        {
+            int32_t peak = 0;
+            for (uint8_t k=1 + b*SPEC_BINS_PER_BAND; k<=(b + 1)*SPEC_BINS_PER_BAND; k++)
+            {
+                int32_t magnitude;
+                CORDIC_atan2(im[k], re[k], &magnitude);
+                if (magnitude > peak)
+                {
+                    peak = magnitude;
+                }
+            }
+            
+            peak >>= SPEC_AMPLITUDE_SHIFT;
+            spec_bands[b][axis] = (peak > INT8_MAX) ? INT8_MAX : (uint8_t)peak;
+            spec_band_sum[b][axis] += spec_bands[b][axis];
+        }
+    }
+    spec_fifo_count++;
+    
+    PROF_stop(PROF_SPECTRUM, start);
+}
+
+
+/*******************************************************************************
+* Function Name: SPEC_getPeakBand
+********************************************************************************
+*
+* Summary:
+*   Get the highest band amplitude of the last FIFO over all bands and axes.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   Band amplitude [LSB].
+*
+*******************************************************************************/
+uint8_t SPEC_getPeakBand(void)
+{
+    uint8_t peak = 0;
+    
+    for (uint8_t b=0; b<SPEC_BANDS; b++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            if (spec_bands[b][axis] > peak)
+            {
+                peak = spec_bands[b][axis];
+            }
+        }
+    }
+    
+    return peak;
+}
+
+
+/*******************************************************************************
+* Function Name: SPEC_getFrame
+********************************************************************************
+*
+* Summary:
+*   Get band amplitudes averaged over the last 4 FIFO once the averaging window
+*   is complete, then restart the window. The frame holds X, Y, Z amplitudes
+*   of each band from the lowest one.
+*
+* Parameters:  
+*   Array of SPEC_FRAME_BYTES to be filled.
+*
+* Return:
+*   1 if the frame is ready, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t SPEC_getFrame(uint8_t* frame)
+{
+    if (spec_fifo_count < SPEC_AVERAGE_FIFO)
+    {
+        return 0;
+    }
+    
+    // Average and restart the window
+    for (uint8_t b=0; b<SPEC_BANDS; b++)
+    {
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            frame[b*3 + axis] = spec_band_sum[b][axis] / spec_fifo_count;
+        }
+    }
+    memset(spec_band_sum, 0, sizeof(spec_band_sum));
+    spec_fifo_count = 0;
+    
+    return 1;
+}
+
+/* [] END OF FILE */
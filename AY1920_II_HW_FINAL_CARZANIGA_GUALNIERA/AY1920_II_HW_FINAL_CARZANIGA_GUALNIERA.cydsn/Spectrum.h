@@ -0,0 +1,45 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the fixed-point
+ * spectral analysis of IMU data, used to
+ * stream band magnitudes instead of raw
+ * samples.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __SPECTRUM_H__
+    
+    #define __SPECTRUM_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "LIS3DH.h"
+    #include "Cordic.h"
+    #include "Profiler.h"
+    
+    /* Useful constants definition. */
+    #define SPEC_FFT_SIZE       LIS3DH_LEVELS_IN_FIFO   // One FIFO per window (160 ms)
+    #define SPEC_FFT_STAGES     5                       // log2(SPEC_FFT_SIZE)
+    #define SPEC_BANDS          8                       // 2 bins (12.5 Hz) each, DC excluded
+    #define SPEC_BINS_PER_BAND  ((SPEC_FFT_SIZE / 2) / SPEC_BANDS)
+    #define SPEC_AMPLITUDE_SHIFT 5                      // Bin magnitude to sine amplitude [LSB]
+    #define SPEC_AVERAGE_FIFO   4                       // Spectra averaged before streaming (0.64 s)
+    #define SPEC_FRAME_BYTES    (SPEC_BANDS * 3)
+    
+    /* Stream packet delimiters. */
+    #define SPEC_STREAM_HEADER  0xA1
+    #define SPEC_STREAM_TAIL    0xC0
+    
+    /* Function prototype declaration. */
+    void SPEC_Init(void);
+    void SPEC_Process(uint8_t* rawData);
+    uint8_t SPEC_getPeakBand(void);
+    uint8_t SPEC_getFrame(uint8_t* frame);
+    
+#endif
+
+/* [] END OF FILE */
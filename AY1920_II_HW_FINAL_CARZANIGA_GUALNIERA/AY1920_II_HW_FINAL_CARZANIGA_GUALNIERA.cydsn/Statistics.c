@@ -0,0 +1,341 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the long-term statistics engine.
+ *
+ * Only over threshold events are logged, so
+ * every FIFO is also added to a few running
+ * accumulators (integer additions only):
+ *
+ * -> Min, max, sum and sum of squares of
+ *    each axis, giving mean and RMS.
+ *
+ * -> Histogram of the acceleration magnitude
+ *    in bins of 0.25 g, computed by comparing
+ *    X^2 + Y^2 + Z^2 with squared bin edges.
+ *
+ * Every 3 hours of acquisition a summary
+ * record of 32 bytes is written to a ring of
+ * 64 EEPROM pages at the end of the memory,
+ * which holds the last 128 records (16 days).
+ * Records carry an increasing sequence number
+ * and a checksum, so that the ring head is
+ * found again at boot and erased or partial
+ * records are skipped.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Statistics.h"
+
+
+/* Accumulators of the current record. */
+static int8_t stats_min[3];
+static int8_t stats_max[3];
+static int32_t stats_sum[3];
+static uint64_t stats_sum_square[3];
+static uint32_t stats_hist[STATS_HIST_BINS];
+static uint16_t stats_peak_square;
+static uint32_t stats_samples;
+static uint32_t stats_fifo;
+
+/* Ring position. */
+static uint16_t stats_next_seq;
+static uint8_t stats_next_slot;
+
+
+/*******************************************************************************
+* Function Name: STATS_reset
+********************************************************************************
+*
+* Summary:
+*   Empty accumulators of the current record.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void STATS_reset(void)
+{
+    memset(stats_min, INT8_MAX, sizeof(stats_min));
+    memset(stats_max, INT8_MIN, sizeof(stats_max));
+    memset(stats_sum, 0, sizeof(stats_sum));
+    memset(stats_sum_square, 0, sizeof(stats_sum_square));
+    memset(stats_hist, 0, sizeof(stats_hist));
+    stats_peak_square = 0;
+    stats_samples = 0;
+    stats_fifo = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: STATS_sqrt
+********************************************************************************
+*
+* Summary:
+*   Integer square root (bit by bit, no division).
+*
+* Parameters:  
+*   32-bit value.
+*
+* Return:
+*   Floor of square root.
+*
+*******************************************************************************/
+static uint16_t STATS_sqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    
+    return (uint16_t)root;
+}
+
+
+/*******************************************************************************
+* Function Name: STATS_isValid
+********************************************************************************
+*
+* Summary:
+*   Check sequence number and checksum of a summary record.
+*
+* Parameters:  
+*   Record buffer.
+*
+* Return:
+*   1 if the record is valid, 0 otherwise.
+*
+*******************************************************************************/
+static uint8_t STATS_isValid(uint8_t* record)
+{
+    uint8_t sum = 0;
+    for (uint8_t i=0; i<STATS_RECORD_BYTE; i++)
+    {
+        sum += record[i];
+    }
+    
+    // Bytes add up to 0xFF, erased records are all zeros
+    return (sum == 0xFF);
+}
+
+
+/*******************************************************************************
+* Function Name: STATS_Init
+********************************************************************************
+*
+* Summary:
+*   Empty accumulators and find the next slot of the ring by scanning the
+*   sequence numbers of the records stored inside the EEPROM.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void STATS_Init(void)
+{
+    STATS_reset();
+    stats_next_seq = 1;
+    stats_next_slot = 0;
+    
+    for (uint8_t slot=0; slot<STATS_RECORD_COUNT; slot++)
+    {
+        uint8_t record[STATS_RECORD_BYTE];
+        EEPROM_readPage(STATS_RING_BASE_ADDR + slot * STATS_RECORD_BYTE, record, STATS_RECORD_BYTE);
+        if (!STATS_isValid(record))
+        {
+            continue;
+        }
+        
+        // Newest record is the ring head
+        uint16_t seq = record[STATS_REC_SEQ_LOW] | (record[STATS_REC_SEQ_HIGH] << 8);
+        if (seq >= stats_next_seq)
+        {
+            stats_next_seq = seq + 1;
+            stats_next_slot = (slot + 1) % STATS_RECORD_COUNT;
+        }
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: STATS_flush
+********************************************************************************
+*
+* Summary:
+*   Build the summary record of the accumulated data, write it to the next
+*   slot of the ring and empty the accumulators.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void STATS_flush(void)
+{
+    uint8_t record[STATS_RECORD_BYTE];
+    memset(record, 0, STATS_RECORD_BYTE);
+    
+    // Sequence number and time
+    uint16_t minutes = (LOG_TIMER_OVERFLOW - MAIN_TIMER_ReadCounter()) / ((uint32_t)LOG_TICK_PER_SECOND * 60);
+    record[STATS_REC_SEQ_LOW] = stats_next_seq & 0xFF;
+    record[STATS_REC_SEQ_HIGH] = (stats_next_seq >> 8) & 0xFF;
+    record[STATS_REC_TIME_LOW] = minutes & 0xFF;
+    record[STATS_REC_TIME_HIGH] = (minutes >> 8) & 0xFF;
+    record[STATS_REC_DURATION] = (stats_fifo * LIS3DH_LEVELS_IN_FIFO) / (LIS3DH_ODR_HZ * 60UL);
+    record[STATS_REC_PEAK] = STATS_sqrt(stats_peak_square);
+    
+    // Min, max, mean and RMS of each axis
+    for (uint8_t axis=0; axis<3; axis++)
+    {
+        uint8_t* field = &record[STATS_REC_AXES + axis*4];
+        field[0] = (uint8_t)stats_min[axis];
+        field[1] = (uint8_t)stats_max[axis];
+        field[2] = (uint8_t)(int8_t)(stats_sum[axis] / (int32_t)stats_samples);
+        field[3] = STATS_sqrt((uint32_t)(stats_sum_square[axis] / stats_samples));
+    }
+    
+    // Histogram as fraction of samples, non-empty bins are at least 1
+    for (uint8_t b=0; b<STATS_HIST_BINS; b++)
+    {
+        uint32_t fraction = (uint32_t)(((uint64_t)stats_hist[b] * 255) / stats_samples);
+        record[STATS_REC_HIST + b] = ((fraction == 0) && (stats_hist[b] > 0)) ? 1 : fraction;
+    }
+    
+    // Bytes add up to 0xFF
+    uint8_t sum = 0;
+    for (uint8_t i=0; i<STATS_REC_CHECKSUM; i++)
+    {
+        sum += record[i];
+    }
+    record[STATS_REC_CHECKSUM] = 0xFF - sum;
+    
+    // Write record (never across a page boundary)
+    EEPROM_writePage(STATS_RING_BASE_ADDR + stats_next_slot * STATS_RECORD_BYTE, record, STATS_RECORD_BYTE);
+    stats_next_slot = (stats_next_slot + 1) % STATS_RECORD_COUNT;
+    stats_next_seq++;
+    
+    STATS_reset();
+}
+
+
+/*******************************************************************************
+* Function Name: STATS_Process
+********************************************************************************
+*
+* Summary:
+*   Add a new FIFO of IMU data to the accumulators and write the summary
+*   record once its period is complete.
+*
+* Parameters:  
+*   Raw FIFO data (32 levels of X, Y, Z low and high registers).
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void STATS_Process(uint8_t* rawData)
+{
+    uint32_t start = PROF_start();
+    
+    for (uint8_t i=0; i<LIS3DH_LEVELS_IN_FIFO; i++)
+    {
+        uint16_t magnitude = 0;
+        
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            // High register only (low power mode)
+            int8_t x = (int8_t)rawData[i*LIS3DH_FIFO_BYTES_IN_LEVEL + axis*2 + 1];
+            uint16_t square = (int16_t)x * x;
+            
+            if (x < stats_min[axis])
+            {
+                stats_min[axis] = x;
+            }
+            if (x > stats_max[axis])
+            {
+                stats_max[axis] = x;
+            }
+            stats_sum[axis] += x;
+            stats_sum_square[axis] += square;
+            magnitude += square;
+        }
+        
+        // Magnitude bin from squared edges
+        uint8_t bin = 0;
+        while ((bin < STATS_HIST_BINS - 1) && (magnitude >= (uint16_t)((bin + 1) * STATS_HIST_STEP) * ((bin + 1) * STATS_HIST_STEP)))
+        {
+            bin++;
+        }
+        stats_hist[bin]++;
+        
+        if (magnitude > stats_peak_square)
+        {
+            stats_peak_square = magnitude;
+        }
+    }
+    stats_samples += LIS3DH_LEVELS_IN_FIFO;
+    stats_fifo++;
+    
+    PROF_stop(PROF_STATS, start);
+    
+    // Persist summary record
+    if (stats_fifo >= STATS_RECORD_FIFO)
+    {
+        STATS_flush();
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: STATS_readRecord
+********************************************************************************
+*
+* Summary:
+*   Read a summary record of the ring by its age, so that records can be sent
+*   one at time from the oldest one (age 0) to the newest one.
+*
+* Parameters:  
+*   Age of the record, record buffer.
+*
+* Return:
+*   1 if the record is valid, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t STATS_readRecord(uint8_t age, uint8_t* record)
+{
+    // Oldest record follows the ring head
+    uint8_t slot = (stats_next_slot + age) % STATS_RECORD_COUNT;
+    EEPROM_readPage(STATS_RING_BASE_ADDR + slot * STATS_RECORD_BYTE, record, STATS_RECORD_BYTE);
+    
+    return STATS_isValid(record);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,49 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the long-term
+ * statistics of IMU data, periodically
+ * persisted inside a ring of EEPROM pages.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __STATISTICS_H__
+    
+    #define __STATISTICS_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "LIS3DH.h"
+    #include "Profiler.h"
+    #include "25LC256.h"
+    
+    /* Useful constants definition. */
+    #define STATS_RECORD_MINUTES    180     // Period of a summary record (3 hours)
+    #define STATS_RECORD_FIFO       ((uint32_t)STATS_RECORD_MINUTES * 60 * LIS3DH_ODR_HZ / LIS3DH_LEVELS_IN_FIFO)
+    #define STATS_RECORD_BYTE       32
+    #define STATS_RECORD_COUNT      (STATS_RING_PAGES * SPI_EEPROM_PAGE_SIZE / STATS_RECORD_BYTE)
+    #define STATS_HIST_BINS         13
+    #define STATS_HIST_STEP         16      // Magnitude bin width [LSB] (0.25 g)
+    
+    /* Summary record layout. */
+    #define STATS_REC_SEQ_LOW       0
+    #define STATS_REC_SEQ_HIGH      1
+    #define STATS_REC_TIME_LOW      2       // End of record [minutes from boot]
+    #define STATS_REC_TIME_HIGH     3
+    #define STATS_REC_DURATION      4       // Acquisition time [minutes]
+    #define STATS_REC_PEAK          5       // Highest magnitude [LSB]
+    #define STATS_REC_AXES          6       // Min, max, mean, RMS of X, Y, Z
+    #define STATS_REC_HIST          18      // Fraction of samples in each bin [1/255]
+    #define STATS_REC_CHECKSUM      31
+    
+    /* Function prototype declaration. */
+    void STATS_Init(void);
+    void STATS_Process(uint8_t* rawData);
+    uint8_t STATS_readRecord(uint8_t age, uint8_t* record);
+    
+#endif
+
+/* [] END OF FILE */
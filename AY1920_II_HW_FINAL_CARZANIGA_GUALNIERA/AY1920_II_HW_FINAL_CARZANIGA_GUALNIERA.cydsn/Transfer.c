@@ -0,0 +1,140 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the pipelined transfer of a span of
+ * EEPROM memory over UART.
+ *
+ * Chunks are read over SPI straight into the
+ * free space of the TX ring buffer, without
+ * any intermediate copy, while the chunks
+ * read before are drained by the UART:
+ *
+ *   +--------+--------+--------+--------+
+ *   | sent   | UART   | SPI    | free   |
+ *   +--------+--------+--------+--------+
+ *             tail     head
+ *
+ * -> While the UART sends the previous chunk
+ *    the next one is read from the EEPROM,
+ *    so EEPROM reads and UART transmission
+ *    overlap and the throughput is limited
+ *    only by the baud rate.
+ *
+ * -> The UART is pumped after every chunk,
+ *    so its FIFO never runs dry during the
+ *    SPI reads when the TX ring is drained
+ *    from the main loop.
+ *
+ * A CRC-16 of the transferred bytes is kept,
+ * so that the caller can close a record.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Transfer.h"
+
+
+/* Span of memory still to be sent. */
+static uint16_t xfer_addr;
+static uint16_t xfer_remaining;
+static uint16_t xfer_crc;
+
+
+/*******************************************************************************
+* Function Name: XFER_start
+********************************************************************************
+*
+* Summary:
+*   Select a span of EEPROM memory to be sent over UART.
+*
+* Parameters:  
+*   16-bit EEPROM address, number of bytes, initial CRC value.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void XFER_start(uint16_t addr, uint16_t nBytes, uint16_t crc)
+{
+    xfer_addr = addr;
+    xfer_remaining = nBytes;
+    xfer_crc = crc;
+}
+
+
+/*******************************************************************************
+* Function Name: XFER_Process
+********************************************************************************
+*
+* Summary:
+*   Move up to XFER_STEP_BYTE bytes of the span from the EEPROM into the TX
+*   ring buffer, one chunk at time. It returns as soon as the ring is full,
+*   without waiting for the UART.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   1 if the whole span has been queued, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t XFER_Process(void)
+{
+    uint16_t budget = XFER_STEP_BYTE;
+    
+    while ((xfer_remaining > 0) && (budget > 0))
+    {
+        // Free space at the head of the ring
+        uint8_t* chunk;
+        uint16_t n_bytes = SERIAL_claim(SERIAL_CHANNEL_BULK, &chunk);
+        if (n_bytes == 0)
+        {
+            break;
+        }
+        
+        // Limit chunk to keep the UART FIFO fed
+        if (n_bytes > XFER_CHUNK_BYTE)
+        {
+            n_bytes = XFER_CHUNK_BYTE;
+        }
+        if (n_bytes > xfer_remaining)
+        {
+            n_bytes = xfer_remaining;
+        }
+        
+        // Read chunk in place, then let the UART send it
+        EEPROM_readPage(xfer_addr, chunk, n_bytes);
+        xfer_crc = CRC_update(xfer_crc, chunk, n_bytes);
+        SERIAL_commit(SERIAL_CHANNEL_BULK, n_bytes);
+        
+        xfer_addr += n_bytes;
+        xfer_remaining -= n_bytes;
+        budget -= (n_bytes < budget) ? n_bytes : budget;
+    }
+    
+    return (xfer_remaining == 0);
+}
+
+
+/*******************************************************************************
+* Function Name: XFER_getCrc
+********************************************************************************
+*
+* Summary:
+*   Get the CRC-16 of the bytes transferred since XFER_start().
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   CRC value.
+*
+*******************************************************************************/
+uint16_t XFER_getCrc(void)
+{
+    return xfer_crc;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,34 @@
+/* ========================================
+ *
+ * This header file contains constants and
+ * function prototypes of the pipelined
+ * transfer of EEPROM memory over UART, used
+ * by log downloads.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __TRANSFER_H__
+    
+    #define __TRANSFER_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "25LC256.h"
+    #include "Serial.h"
+    #include "CRC.h"
+    
+    /* Useful constants definition. */
+    #define XFER_CHUNK_BYTE         16  // Bytes read over SPI between two pumps of the UART
+    #define XFER_STEP_BYTE          SPI_EEPROM_PAGE_SIZE    // Bytes moved at each call
+    
+    /* Function prototype declaration. */
+    void XFER_start(uint16_t addr, uint16_t nBytes, uint16_t crc);
+    uint8_t XFER_Process(void);
+    uint16_t XFER_getCrc(void);
+    
+#endif
+
+/* [] END OF FILE */
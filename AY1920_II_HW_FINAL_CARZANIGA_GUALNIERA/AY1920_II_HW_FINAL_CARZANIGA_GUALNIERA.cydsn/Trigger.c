@@ -0,0 +1,257 @@
+/* ========================================
+ *
+ * This file contains all function definitions
+ * of the software trigger engine.
+ *
+ * The LIS3DH interrupt generator only compares
+ * each axis with a threshold. Every new FIFO
+ * is also checked here against up to 4 rules
+ * on the whole acceleration vector:
+ *
+ * -> Magnitude: X^2 + Y^2 + Z^2.
+ *
+ * -> Jerk: squared difference between two
+ *    consecutive samples.
+ *
+ * -> RMS: mean square over 32 samples of the
+ *    data without gravity (estimated by a
+ *    slow exponential moving average), to
+ *    detect sustained vibrations.
+ *
+ * -> Band: highest band amplitude of the FIFO
+ *    spectrum, held for all of its samples,
+ *    to detect vibrations in a frequency band.
+ *
+ * A rule fires when its value stays over the
+ * threshold for a number of consecutive
+ * samples (duration). Only integer additions,
+ * multiplications and shifts are used, and
+ * the cost per FIFO is bounded by 32 samples
+ * times 4 rules, measured by the profiler.
+ *
+ * The event is then captured by the same path
+ * of the LIS3DH over threshold interrupt, the
+ * FIFO just read holding the trigger sample.
+ *
+ * ========================================
+*/
+
+
+/* Project dependencies. */
+#include "Trigger.h"
+
+
+/* Configured rules and number of consecutive samples over threshold. */
+static trig_rule_t trig_rules[TRIG_MAX_RULES];
+static uint8_t trig_hold[TRIG_MAX_RULES];
+
+/* Rule values state. */
+static int8_t trig_previous[3];
+static int32_t trig_gravity[3];
+static uint8_t trig_started;
+static uint16_t trig_rms_window[TRIG_RMS_WINDOW];
+static uint32_t trig_rms_sum;
+static uint8_t trig_rms_index;
+
+
+/*******************************************************************************
+* Function Name: TRIG_Init
+********************************************************************************
+*
+* Summary:
+*   Disable all rules and reset their state.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+void TRIG_Init(void)
+{
+    memset(trig_rules, 0, sizeof(trig_rules));
+    memset(trig_hold, 0, sizeof(trig_hold));
+    memset(trig_previous, 0, sizeof(trig_previous));
+    memset(trig_gravity, 0, sizeof(trig_gravity));
+    trig_started = 0;
+    memset(trig_rms_window, 0, sizeof(trig_rms_window));
+    trig_rms_sum = 0;
+    trig_rms_index = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: TRIG_setRule
+********************************************************************************
+*
+* Summary:
+*   Configure a trigger rule (safe to be called from an ISR).
+*
+* Parameters:  
+*   Rule index, rule type (TRIG_RULE_OFF disables it), threshold in LSB^2 (LSB
+*   for band rule), minimum number of consecutive samples over threshold.
+*
+* Return:
+*   1 if the rule is applied, 0 if index or type are not valid.
+*
+*******************************************************************************/
+uint8_t TRIG_setRule(uint8_t index, uint8_t type, uint16_t threshold, uint8_t duration)
+{
+    if ((index >= TRIG_MAX_RULES) || (type >= TRIG_RULE_TYPES))
+    {
+        return 0;
+    }
+    
+    // Disable rule while it is updated
+    trig_rules[index].type = TRIG_RULE_OFF;
+    trig_rules[index].threshold = threshold;
+    trig_rules[index].duration = (duration == 0) ? 1 : duration;
+    trig_hold[index] = 0;
+    trig_rules[index].type = type;
+    
+    return 1;
+}
+
+
+/*******************************************************************************
+* Function Name: TRIG_Process
+********************************************************************************
+*
+* Summary:
+*   Update rule values with a new FIFO of IMU data and check all enabled rules.
+*   All samples are processed even after a rule fires, so that the state is
+*   always up to date.
+*
+* Parameters:  
+*   Raw FIFO data (32 levels of X, Y, Z low and high registers), pointers to
+*   the FIFO level of the trigger sample and to the interrupt register of the
+*   event.
+*
+* Return:
+*   1 if a rule fired, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t TRIG_Process(uint8_t* rawData, uint8_t* level, uint8_t* intReg)
+{
+    uint32_t start = PROF_start();
+    uint8_t fired = 0;
+    
+    // Spectrum of the FIFO must be already computed
+    uint32_t band = SPEC_getPeakBand();
+    
+    for (uint8_t i=0; i<LIS3DH_LEVELS_IN_FIFO; i++)
+    {
+        uint32_t magnitude = 0;
+        uint32_t jerk = 0;
+        uint32_t power = 0;
+        
+        for (uint8_t axis=0; axis<3; axis++)
+        {
+            // High register only (low power mode)
+            int8_t x = (int8_t)rawData[i*LIS3DH_FIFO_BYTES_IN_LEVEL + axis*2 + 1];
+            
+            // Start state from the first sample to avoid a false trigger
+            if (trig_started == 0)
+            {
+                trig_previous[axis] = x;
+                trig_gravity[axis] = (int32_t)x << 8;
+            }
+            
+            // Squared magnitude
+            magnitude += (int16_t)x * x;
+            
+            // Squared difference with previous sample
+            int16_t d = (int16_t)x - trig_previous[axis];
+            jerk += (int32_t)d * d;
+            trig_previous[axis] = x;
+            
+            // Remove gravity estimate (Q8)
+            int32_t q = (int32_t)x << 8;
+            trig_gravity[axis] += (q - trig_gravity[axis]) >> TRIG_GRAVITY_SHIFT;
+            int16_t ac = (int16_t)((q - trig_gravity[axis]) >> 8);
+            power += (int32_t)ac * ac;
+        }
+        
+        trig_started = 1;
+        
+        // Mean square over the window
+        if (power > UINT16_MAX)
+        {
+            power = UINT16_MAX;
+        }
+        trig_rms_sum += power - trig_rms_window[trig_rms_index];
+        trig_rms_window[trig_rms_index] = power;
+        trig_rms_index = (trig_rms_index + 1) % TRIG_RMS_WINDOW;
+        uint32_t mean_square = trig_rms_sum >> TRIG_RMS_SHIFT;
+        
+        // Check all rules
+        for (uint8_t r=0; r<TRIG_MAX_RULES; r++)
+        {
+            uint32_t value;
+            switch (trig_rules[r].type)
+            {
+                case (TRIG_RULE_MAGNITUDE): value = magnitude; break;
+                case (TRIG_RULE_JERK): value = jerk; break;
+                case (TRIG_RULE_RMS): value = mean_square; break;
+                case (TRIG_RULE_BAND): value = band; break;
+                default: continue;
+            }
+            
+            // Count consecutive samples over threshold
+            if (value > trig_rules[r].threshold)
+            {
+                if (trig_hold[r] < UINT8_MAX)
+                {
+                    trig_hold[r]++;
+                }
+            }
+            else
+            {
+                trig_hold[r] = 0;
+            }
+            
+            // Fire on the first sample reaching the duration
+            if ((fired == 0) && (trig_hold[r] == trig_rules[r].duration))
+            {
+                *level = i;
+                *intReg = TRIG_INT_REG_SOFTWARE | TRIG_INT_REG_IA | (r & TRIG_INT_REG_RULE_MASK);
+                fired = 1;
+            }
+        }
+    }
+    
+    PROF_stop(PROF_TRIGGER, start);
+    return fired;
+}
+
+
+/*******************************************************************************
+* Function Name: TRIG_isActive
+********************************************************************************
+*
+* Summary:
+*   Check if any enabled rule is still over threshold at the end of the last
+*   processed FIFO, so that the event under capture is kept open.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   1 if a rule condition persists, 0 otherwise.
+*
+*******************************************************************************/
+uint8_t TRIG_isActive(void)
+{
+    for (uint8_t r=0; r<TRIG_MAX_RULES; r++)
+    {
+        if ((trig_rules[r].type != TRIG_RULE_OFF) && (trig_hold[r] > 0))
+        {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/* [] END OF FILE */
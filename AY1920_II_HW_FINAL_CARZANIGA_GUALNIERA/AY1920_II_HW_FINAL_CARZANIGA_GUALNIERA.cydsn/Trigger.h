@@ -0,0 +1,59 @@
+/* ========================================
+ *
+ * This header file contains constants,
+ * data types and function prototypes of the
+ * software trigger engine, which detects
+ * events the LIS3DH interrupt generator
+ * cannot express.
+ *
+ * ========================================
+*/
+
+
+/* Header guard. */
+#ifndef __TRIGGER_H__
+    
+    #define __TRIGGER_H__
+    
+    /* Project dependencies. */
+    #include "project.h"
+    #include "LIS3DH.h"
+    #include "Profiler.h"
+    #include "Spectrum.h"
+    
+    /* Useful constants definition. */
+    #define TRIG_MAX_RULES      4
+    #define TRIG_RULE_BYTE      5   // Rule index, type, threshold (LE), duration
+    #define TRIG_RMS_WINDOW     32  // Samples of the RMS window (160 ms)
+    #define TRIG_RMS_SHIFT      5   // log2(TRIG_RMS_WINDOW)
+    #define TRIG_GRAVITY_SHIFT  8   // Gravity estimate time constant: 256 samples (1.28 s)
+    
+    /* Rule types. */
+    #define TRIG_RULE_OFF       0   // Rule disabled
+    #define TRIG_RULE_MAGNITUDE 1   // X^2 + Y^2 + Z^2 > threshold
+    #define TRIG_RULE_JERK      2   // Squared difference of consecutive samples > threshold
+    #define TRIG_RULE_RMS       3   // Mean square of gravity-free data over the window > threshold
+    #define TRIG_RULE_BAND      4   // Highest spectral band amplitude of the FIFO > threshold
+    #define TRIG_RULE_TYPES     5
+    
+    /* Interrupt register of software events (bit 7 is always 0 in LIS3DH INT1_SRC). */
+    #define TRIG_INT_REG_SOFTWARE   0x80
+    #define TRIG_INT_REG_IA         0x40
+    #define TRIG_INT_REG_RULE_MASK  0x03
+    
+    /* Trigger rule type. */
+    typedef struct {
+        uint8_t type;
+        uint8_t duration;
+        uint16_t threshold;
+    } trig_rule_t;
+    
+    /* Function prototype declaration. */
+    void TRIG_Init(void);
+    uint8_t TRIG_setRule(uint8_t index, uint8_t type, uint16_t threshold, uint8_t duration);
+    uint8_t TRIG_Process(uint8_t* rawData, uint8_t* level, uint8_t* intReg);
+    uint8_t TRIG_isActive(void);
+    
+#endif
+
+/* [] END OF FILE */
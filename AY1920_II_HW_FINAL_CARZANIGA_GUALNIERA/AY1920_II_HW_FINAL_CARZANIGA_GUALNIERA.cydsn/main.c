@@ -26,20 +26,46 @@
  *    the send flag and allow transmission of
  *    IMU data over UART.
  *
+ * Button ISRs only set a flag: the state change
+ * and its save inside the EEPROM are done by
+ * the main loop, the only user of the EEPROM
+ * SPI bus.
+ *
  * ========================================
  *
  * LIS3DH FIFO data reading:
  * 
+ * The LIS3DH FIFO runs in stream-to-FIFO mode:
+ * until an over threshold event it always holds
+ * the most recent samples, then it freezes as 
+ * soon as it is full so that the samples around
+ * the event are kept by the sensor itself.
+ * 
  * This section is executed when the flag
- * for the fifo data ready is set by a 
+ * for the fifo data ready is set by a
  * custom ISR coming from the LIS3DH.
- * The current 32 levels of the FIFO are 
- * stored in a buffer for the drive of the 
- * LED RGB, while a down-sampled copy of the
- * data is stored in a queue. This is done in
- * order to maintain a brief history of the
- * data and be able to log it into the EEPROM
- * when needed.
+ * The current 32 levels of the FIFO are
+ * read into a buffer and used right away
+ * (nothing is recomputed between two FIFO):
+ * -> DSP: the DSP chain selected at runtime
+ *    filters the data for LED and stream.
+ * -> Spectrum: a fixed-point FFT updates the
+ *    amplitudes of 8 frequency bands.
+ * -> Statistics: long-term statistics are
+ *    updated with every FIFO.
+ * -> Trigger: software rules on the FIFO
+ *    may open an over threshold event.
+ * -> LED: the LED RGB is driven by the
+ *    filtered data in start mode.
+ * -> Store: a copy of the data filtered by
+ *    the anti-aliasing decimator (ratio 2,
+ *    4 or 8) is kept in a queue, as a brief
+ *    history to be logged into the EEPROM
+ *    when needed.
+ * -> Stream: if the send flag is set, XYZ,
+ *    roll, pitch and magnitude (fixed-point
+ *    CORDIC) or band amplitudes are sent
+ *    over UART.
  *
  * ========================================
  *
@@ -48,11 +74,38 @@
  * This section is executed when the flag
  * for the over threshold event is set by a
  * custom ISR coming from the LIS3DH.
- * A log type message is generated given the
- * information about the event and the
- * payload that is retrieved from IMU queue.
- * Finally, the message is successfully 
- * stored inside the EEPROM memory.
+ * A log event is opened given the information
+ * about the event and the pre-trigger history
+ * that is retrieved from IMU queue. This is
+ * done before reading the FIFO that holds the
+ * event, so that the FIFO level saved by the
+ * ISR locates the event inside the payload.
+ * Every new FIFO is then appended to the event
+ * while the over threshold condition persists,
+ * up to a maximum event size. With multi-
+ * resolution capture the FIFO holding the
+ * event is kept at the full 200 Hz rate (core
+ * window), while the pre-trigger history and
+ * the following FIFO (context) are decimated
+ * like the IMU queue, so that the impact peak
+ * is not aliased and a longer window fits the
+ * same space. Finally, the event is
+ * committed to a RAM staging queue, which is
+ * drained to the EEPROM in background one page
+ * per loop iteration, using only the pages
+ * needed by the event actual length. Bursts
+ * of events are therefore captured in full
+ * while previous ones are still being stored.
+ * Events can also be raised by the software
+ * trigger engine, which checks magnitude,
+ * jerk and sustained RMS rules on every new
+ * FIFO: the event is opened right away and
+ * the FIFO just read becomes the core window.
+ * Every FIFO also updates long-term statistics
+ * (min, max, mean, RMS and magnitude histogram)
+ * that are persisted every 3 hours to a ring
+ * of EEPROM pages, so that the context between
+ * events is not lost.
  *
  * ========================================
 */
@@ -62,8 +115,181 @@
 #include "InterruptRoutines.h"
 #include "RGB_Driver.h"
 #include "LogUtils.h"
+#include "LogQueue.h"
 #include "25LC256.h"
 #include "LIS3DH.h"
+#include "DSP_Chain.h"
+#include "Cordic.h"
+#include "Trigger.h"
+#include "Spectrum.h"
+#include "Statistics.h"
+#include "Frame.h"
+#include "Command.h"
+
+
+/* Over threshold event under capture (NULL if dropped by full queue). */
+static log_event_t* log_event;
+static uint8_t log_event_active;
+static uint8_t log_event_fifo;
+
+
+/*******************************************************************************
+* Function Name: openEvent
+********************************************************************************
+*
+* Summary:
+*   Open a new log event in the staging queue and insert the pre-trigger
+*   history, if not already capturing one. The next FIFO appended to the event
+*   is the one holding the trigger sample.
+*
+* Parameters:  
+*   Interrupt register content, FIFO level of the trigger sample.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void openEvent(uint8_t intReg, uint8_t level)
+{
+    // Following triggers are merged to the event under capture
+    if (log_event_active == 1)
+    {
+        return;
+    }
+    
+    // Get timestamp in seconds from boot
+    uint16_t timestamp = LOG_getTimestamp();
+    
+    // Trigger sample follows the pre-trigger history and the FIFO samples before the event
+    uint8_t trigger = LOG_PRE_TRIGGER_FIFO * LOG_CONTEXT_ROWS_PER_FIFO + level / LOG_CORE_DOWN_SAMPLE;
+    
+    // Get free slot of the staging queue
+    log_event = QUEUE_openEvent();
+    if (log_event != NULL)
+    {
+        // Create log event (ID is assigned once stored)
+        LOG_initEvent(log_event, 0, intReg, timestamp, trigger);
+        
+        // Insert pre-trigger history from the IMU queue at context rate
+        uint8_t history[LOG_PRE_TRIGGER_FIFO * LIS3DH_BYTES_IN_FIFO_DOWNSAMPLED];
+        uint16_t n_bytes = IMU_getHistory(history, LOG_PRE_TRIGGER_FIFO);
+        LOG_appendEvent(log_event, history, n_bytes);
+    }
+    
+    // Next FIFO (holding the event) will be appended until the end of the event
+    log_event_fifo = 0;
+    log_event_active = 1;
+}
+
+
+/*******************************************************************************
+* Function Name: toggleConfigMode
+********************************************************************************
+*
+* Summary:
+*   Toggle the configuration mode state after a long press of the on-board
+*   button and save the config flag inside EEPROM.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void toggleConfigMode(void)
+{
+    if (button_state != CONFIG_MODE)
+    {
+        // Stop IMU interrupt events if was in START_MODE
+        if (button_state == START_MODE)
+        {
+            IMU_Stop();
+        }
+        
+        // Enter configuration mode
+        button_state = CONFIG_MODE;
+        
+        // Save config flag inside EEPROM
+        EEPROM_saveConfigFlag(1);
+        
+        // Blink on-board LED
+        LED_Notify_Config();
+    }
+    else
+    {
+        // Resume start/stop mode
+        button_state = EEPROM_retrieveStartStopState();
+        
+        // Reset config flag inside EEPROM
+        EEPROM_saveConfigFlag(0);
+        
+        if (button_state == STOP_MODE)
+        {
+            // Turn on-board LED off
+            LED_Notify_Stop();
+        }
+        else if (button_state == START_MODE)
+        {
+            // Turn on-board LED on
+            LED_Notify_Start();
+            
+            // Start IMU interrupt events
+            IMU_Start();
+        }
+        
+        // Save send flag inside EEPROM
+        EEPROM_saveSendFlag(send_flag);
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: toggleStartMode
+********************************************************************************
+*
+* Summary:
+*   Toggle the start/stop state after a double click of the on-board button
+*   and save it inside EEPROM. Nothing is done in configuration mode.
+*
+* Parameters:  
+*   None.
+*
+* Return:
+*   None.
+*
+*******************************************************************************/
+static void toggleStartMode(void)
+{
+    if (button_state == START_MODE)
+    {
+        // Stop IMU interrupt events
+        IMU_Stop();
+        
+        // Save stop bit inside EEPROM
+        EEPROM_saveStartStopState(0);
+        
+        // Turn on-board LED off
+        LED_Notify_Stop();
+        
+        // Update button state
+        button_state = STOP_MODE;
+    }
+    else if (button_state == STOP_MODE)
+    {
+        // Start IMU interrupt events
+        IMU_Start();
+        
+        // Save start bit inside EEPROM
+        EEPROM_saveStartStopState(1);
+        
+        // Turn on-board LED on
+        LED_Notify_Start();
+        
+        // Update button state
+        button_state = START_MODE;
+    }
+}
 
 
 /* Main function definition. */
@@ -74,93 +300,244 @@ int main(void)
     
     // Enable UART communication
     UART_Start();
+    SERIAL_Init();
     
     // Enable all SPI modules
     SPIM_IMU_Start();
     SPIM_EEPROM_Start();
     CyDelay(10);
-
+    
     // Initialize all timers 
     BUTTON_TIMER_Start();
     CLICK_TIMER_Start();
     MAIN_TIMER_Start();
     
+    // Enable CPU cycle counter for profiling
+    PROF_Init();
+    
     // Initialize ADC
     ADC_DELSIG_Start();
- 
+    
     // Setup all LIS3DH registers
     IMU_Init();
     
     // Initliazide RGB LED
     RGB_Init();
     
+    // Select default filters of LED and UART stream
+    DSP_Init();
+    
+    // Disable all software trigger rules
+    TRIG_Init();
+    SPEC_Init();
+    
+    // Select default stream format
+    FRAME_Init();
+    
+    // Empty buffer of remote commands
+    CMD_Init();
+    
     // Enable all ISRs
     ISR_CONFIG_StartEx(CUSTOM_ISR_CONFIG);
     ISR_START_StartEx(CUSTOM_ISR_START);
     ISR_IMU_StartEx(CUSTOM_ISR_IMU);
     ISR_RX_StartEx(CUSTOM_ISR_RX);
+#if (SERIAL_TX_INTERRUPT)
+    CyIntSetVector(UART_TX_VECT_NUM, CUSTOM_ISR_TX);
+#endif
 
     // End of setup
     CyDelay(10);
     
     // Initialize button state
+    button_config_flag = 0;
+    button_start_flag = 0;
     button_state = STOP_MODE;
     EEPROM_saveStartStopState(0);
     
     // Initialize send flag
     send_flag = 0;
+    stream_mode = STREAM_XYZ;
     
     // Initialize IMU flags
     IMU_data_ready_flag = 0;
     IMU_over_threshold_flag = 0;
-
+    IMU_trigger_level = 0;
+    
+    // Initialize event capture and staging queue
+    log_event = NULL;
+    log_event_active = 0;
+    QUEUE_Init();
+    
     // Uncomment this to erase EEPROM memory
     //EEPROM_resetMemory();
     
+    // Rebuild catalog of stored logs
+    CATALOG_Init();
+    
+    // Find head of the statistics ring
+    STATS_Init();
+    
     // Main loop
     for(;;)
     {   
+        // Button events (EEPROM is accessed by the main loop only)
+        if (button_config_flag == 1)
+        {
+            button_config_flag = 0;
+            toggleConfigMode();
+        }
+        if (button_start_flag == 1)
+        {
+            button_start_flag = 0;
+            toggleStartMode();
+        }
+        
         // Board state handler
         switch (button_state)
         {
             case STOP_MODE:
-                
+            
                 // Turn LED off
                 RGB_Stop();
                 break;
             
             case START_MODE:
-                
-                // Drive LED based on IMU data
-                RGB_Driver(IMU_DataBuffer);
+            
+                // Restore LED output (PWMs are written only if changed)
+                PWM_Driver(RGB_DataBuffer);
                 break;
-     
+            
             case CONFIG_MODE:
-                
+            
                 // Read knob value to set send flag
                 send_flag = POT_Read_Value(send_flag);
-                   
+                
                 // Drive LED blue channel based on flag
                 RGB_sendFlagNotify(send_flag);
                 break;  
         }
-
+        
+        // IMU ISR over threshold event
+        if (IMU_over_threshold_flag == 1)
+        {   
+            // Open a new event if not already capturing one
+            if (log_event_active == 0)
+            {
+                // Get interrupt register with info about event
+                uint8_t int_reg = IMU_ReadByte(LIS3DH_INT1_SRC);
+                openEvent(int_reg, IMU_trigger_level);
+            }
+            
+            // End of over threshold event (following interrupts are merged)
+            IMU_over_threshold_flag = 0;
+        }
+        
         // IMU ISR FIFO data overrun event
         if (IMU_data_ready_flag == 1)
         {
             // Read data via SPI from IMU
             IMU_ReadFIFO(IMU_DataBuffer);
             
+            // Filter new IMU data for LED and UART stream
+            DSP_Process(IMU_DataBuffer, DSP_DataBuffer);
+            
+            // Band amplitudes for spectrum stream and band rules
+            SPEC_Process(IMU_DataBuffer);
+            
+            // Long-term statistics of every FIFO
+            STATS_Process(IMU_DataBuffer);
+            
+            // Check software trigger rules, FIFO just read holds the event
+            uint8_t trigger_level, trigger_reg;
+            if (TRIG_Process(IMU_DataBuffer, &trigger_level, &trigger_reg) == 1)
+            {
+                openEvent(trigger_reg, trigger_level);
+            }
+            
+            // Drive LED based on new IMU data only
+            if (button_state == START_MODE)
+            {
+                RGB_Driver(DSP_DataBuffer);
+            }
+            
             // Store the read FIFO in the LOG buffer
             IMU_StoreFIFO(IMU_DataBuffer);
             
             // Check EEPROM if send flag is set
             if (EEPROM_retrieveSendFlag() == 1)
             {
-                //Send data read from FIFO via UART
-                IMU_DataSend(IMU_DataBuffer);
+                if (stream_mode == STREAM_ORIENTATION)
+                {
+                    // Send tilt of raw data (gravity is needed) via UART
+                    uint8_t orientation_data[LIS3DH_BYTES_IN_FIFO_HIGH_REG];
+                    IMU_decimateFIFO(orientation_data, IMU_DataBuffer, 1);
+                    CORDIC_Orientation(orientation_data, LIS3DH_LEVELS_IN_FIFO, orientation_data);
+                    FRAME_sendRows(FRAME_CONTENT_ORIENTATION, orientation_data, LIS3DH_LEVELS_IN_FIFO);
+                }
+                else if (stream_mode == STREAM_SPECTRUM)
+                {
+                    // Send band amplitudes averaged over the last FIFO
+                    uint8_t band_data[SPEC_FRAME_BYTES];
+                    if (SPEC_getFrame(band_data))
+                    {
+                        FRAME_sendRows(FRAME_CONTENT_SPECTRUM, band_data, SPEC_BANDS);
+                    }
+                }
+                else if (FRAME_getFormat() == FRAME_FORMAT_WIDE)
+                {
+                    // Send raw FIFO at full resolution (DSP chain works on high registers only)
+                    FRAME_sendWide(FRAME_CONTENT_XYZ, IMU_DataBuffer, LIS3DH_LEVELS_IN_FIFO);
+                }
+                else
+                {
+                    //Send data read from FIFO via UART
+                    FRAME_sendRows(FRAME_CONTENT_XYZ, DSP_DataBuffer, LIS3DH_LEVELS_IN_FIFO);
+                }
             }
-
+            
+            // Keep capturing over threshold event
+            if (log_event_active == 1)
+            {
+                // Append the read FIFO to the event payload
+                if (log_event != NULL)
+                {
+                    uint8_t fifo_data[LOG_CORE_ROWS_PER_FIFO * 3];
+                    if (log_event_fifo == 0)
+                    {
+                        // FIFO holding the event is the core window
+#if (LOG_MULTI_RESOLUTION)
+                        uint16_t n_bytes = IMU_decimateFIFO(fifo_data, IMU_DataBuffer, LOG_CORE_DOWN_SAMPLE);
+#else
+                        uint16_t n_bytes = IMU_getHistory(fifo_data, 1);
+#endif
+                        LOG_appendEventCore(log_event, fifo_data, n_bytes);
+                    }
+                    else
+                    {
+                        // Following FIFO are context, already filtered inside the IMU queue
+                        uint16_t n_bytes = IMU_getHistory(fifo_data, 1);
+                        LOG_appendEvent(log_event, fifo_data, n_bytes);
+                    }
+                }
+                
+                // Number of FIFO captured from the over threshold event
+                log_event_fifo++;
+                uint8_t event_full = (log_event_fifo >= LOG_EVENT_MAX_FIFO - LOG_PRE_TRIGGER_FIFO);
+                
+                // Close event when over threshold condition (hardware and software) ends or event is full
+                if (event_full || ((log_event_fifo >= LOG_POST_TRIGGER_FIFO) && 
+                    !(IMU_ReadByte(LIS3DH_INT1_SRC) & LIS3DH_INT1_SRC_IA_MASK) && !TRIG_isActive()))
+                {
+                    // Stage event to be stored inside EEPROM
+                    if (log_event != NULL)
+                    {
+                        QUEUE_commitEvent();
+                    }
+                    log_event_active = 0;
+                }
+            }
+            
             // Reset the FIFO to enable next ISR occurrences
             IMU_ResetFIFO();
             
@@ -168,40 +545,25 @@ int main(void)
             IMU_data_ready_flag = 0;
         }
         
-        // IMU ISR over threshold event
-        if (IMU_over_threshold_flag == 1)
-        {   
-            // Get sequential ID number
-            uint8_t log_id = EEPROM_retrieveLogCount();
-            
-            // Get interrupt register with info about event
-            uint8_t int_reg = IMU_ReadByte(LIS3DH_INT1_SRC);
-            
-            // Get timestamp in seconds from boot
-            uint16_t timestamp = LOG_getTimestamp();
-            
-            // Capture all over threshold event's interrupts
-            while(IMU_ReadByte(LIS3DH_INT1_SRC) & (LIS3DH_INT1_SRC_IA_MASK)){}
-  
-            for (uint8_t i=0; i<LOG_PAGES_PER_EVENT; i++)
-            {        
-                // Get payload of 60 bytes from the IMU queue
-                uint8_t payload[LOG_MESSAGE_DATA_BYTE];
-                IMU_getPayload(payload, i);
-                
-                // Create log type message
-                log_t log_message = LOG_createMessage(log_id, int_reg, timestamp, payload);
-                
-                // Store message inside EEPROM
-                EEPROM_storeLogMessage(log_message);
+        // Close pending event if data acquisition has been stopped
+        if ((log_event_active == 1) && (button_state != START_MODE))
+        {
+            // Stage event to be stored inside EEPROM
+            if (log_event != NULL)
+            {
+                QUEUE_commitEvent();
             }
-            
-            // Reset the FIFO to enable new ISR occurrences
-            IMU_ResetFIFO();
-            
-            // End of over threshold event
-            IMU_over_threshold_flag = 0;
-        }   
+            log_event_active = 0;
+        }
+        
+        // Store staged events inside EEPROM one page at time
+        QUEUE_drainEvent();
+        
+        // Execute remote commands (long ones one step at time)
+        CMD_Process();
+        
+        // Move queued bytes into the UART FIFO
+        SERIAL_Pump();
     }
     
     return 0;
@@ -4,6 +4,9 @@ import serial
 from tabulate import tabulate
 import numpy as np
 import struct
+import binascii
+import time
+import mmap
 import matplotlib
 import matplotlib
 matplotlib.use('Qt4Agg')
@@ -12,18 +15,137 @@ from matplotlib import pyplot as plt
 
 BAUDRATE = 115200
 
+# Log message (EEPROM page) layout
+LOG_PAGE_SIZE = 64
+LOG_HEADER_SIZE = 4
+LOG_DATA_SIZE = LOG_PAGE_SIZE - LOG_HEADER_SIZE
+LOG_DESC_SIZE = 20
+LOG_SUMMARY_OFFSET = 10
+LOG_SUMMARY_SIZE = 10
+LOG_CATALOG_ENTRY_SIZE = 7 + LOG_SUMMARY_SIZE
+
+# Catalog columns the host can rank logs by (event summary stored in the descriptor)
+CATALOG_SORT_KEYS = ['Peak', 'Time over threshold', 'RMS', 'Timestamp']
+
+# Payload format: mask of full rate axes, other axes averaged every LOG_COARSE_RATIO samples
+LOG_FORMAT_DENSE = 0x07
+LOG_COARSE_RATIO = 8
+
+# LIS3DH output data rate, stored samples are decimated by the factors in the event descriptor
+LOG_DATA_RATE = 200.0
+
 """ 'R' = reset EEPROM
     'C' = request control register status of the EEPROM
     'L' + 'logID'= request specific log by ID
     'N' = request number of logs stored in the EEPROM
+    'Q' = request status of the RAM staging queue of events
+    'I' = request catalog of stored logs with event summary, ranked and filtered
+    'P' = request CPU cycles spent by profiled firmware sections
+    'D' + 'mask' = select the stages of the DSP chain feeding LED and UART stream
+    'O' + 'mode' = select the UART stream content (XYZ, orientation or spectrum)
+    'T' + 'rule' = configure a software trigger rule
+    'S' = request long-term statistics records
+    'U' = request UART TX ring buffer counters
+    'F' + 'format' = select the UART stream format (legacy packets or frames)
+    'M' = monitor the framed UART stream (host only)
+    'B' + 'selection' + 'first ID' + 'last ID' = download a span of logs in a single response
+    'E' + 'address' + 'length' = dump the raw EEPROM image to a file
+    'W' + 'address' + 'length' + pages = restore the raw EEPROM image from a file
+    'X' + 'mode' = send channels raw or inside link frames (sent at startup)
+    'V' = collect logs as soon as their notification is pushed (host only)
 """
-COMMAND_LIST = ['R', 'C', 'L', 'N']
+COMMAND_LIST = ['R', 'C', 'L', 'N', 'Q', 'I', 'P', 'D', 'O', 'T', 'S', 'U', 'F', 'M', 'B', 'E', 'W', 'V']
+
+# Range download (same as CMD_RANGE_* in Command.h)
+RANGE_SPAN = 0
+RANGE_NEWER = 1
+RANGE_RECORD_HEADER_SIZE = 2
+RANGE_RECORD_CRC_SIZE = 2
+RANGE_MODES = ['All logs', 'Span of IDs', 'Logs newer than an ID']
+
+# Raw EEPROM image (same as CMD_IMAGE_* in Command.h and 25LC256.h)
+EEPROM_SIZE = 32768
+IMAGE_BLOCK_SIZE = 256
+IMAGE_CRC_SIZE = 2
+IMAGE_RETRIES = 3
+IMAGE_ABORT = 0x41
+IMAGE_ACK_TIMEOUT = 2.0
+CTRL_REG_LOG_PAGES = 0x08
+CTRL_REG_LOG_COUNT = 0x0A
+CTRL_REG_LOG_NEXT_ID = 0x0B
+LOG_DATA_BASE_ADDR = 0x0040
+STATS_RING_BASE_ADDR = (512 - 64) * LOG_PAGE_SIZE
+STATS_RING_SIZE = 64 * LOG_PAGE_SIZE
+
+# Firmware sections profiled with the DWT cycle counter (same order as prof_section_t)
+PROFILE_SECTIONS = ['Decimator (per FIFO)', 'DSP median (per FIFO)', 'DSP high-pass (per FIFO)',
+                    'DSP low-pass (per FIFO)', 'DSP average (per FIFO)', 'DSP envelope (per FIFO)',
+                    'CORDIC orientation (per FIFO)', 'Trigger rules (per FIFO)',
+                    'Spectrum (per FIFO)', 'Statistics (per FIFO)', 'Stream codec (per FIFO)']
+
+# DSP chain stages (same bits as DSP_STAGE_* in DSP_Chain.h)
+DSP_STAGES = ['Median', 'High-pass', 'Low-pass', 'Average', 'Envelope']
+
+# UART stream content (same order as stream_t)
+STREAM_MODES = ['XYZ (filtered by the DSP chain)', 'Orientation (roll, pitch, magnitude)',
+                'Spectrum (amplitude of 8 bands of 12.5 Hz per axis, every 0.64 s)']
+
+# UART stream formats (same order as FRAME_FORMAT_* in Frame.h)
+STREAM_FORMATS = ['Legacy (A0 X Y Z C0 per sample, Bridge Control Panel)', 'Frames of 8-bit samples',
+                  'Frames of 16-bit raw samples', 'Frames of 8-bit samples compressed (delta, zigzag, Rice)']
+
+# Stream codec (same as CODEC_* in Codec.h)
+CODEC_K_BITS = 3
+CODEC_ESCAPE_QUOTIENT = 12
+CODEC_ESCAPE_BITS = 9
+
+# Stream frame layout (see Frame.c)
+FRAME_SYNC = b'\x5a\xa5'
+FRAME_HEADER_SIZE = 10
+FRAME_CRC_SIZE = 2
+FRAME_TYPE_WIDE = 0x10
+FRAME_TYPE_RICE = 0x20
+FRAME_MAX_SIZE = FRAME_HEADER_SIZE + 32 * 6 + FRAME_CRC_SIZE
+
+# Software trigger rules (same order as TRIG_RULE_* in Trigger.h)
+TRIGGER_RULES = ['Off', 'Magnitude', 'Jerk', 'RMS', 'Band']
+TRIGGER_MAX_RULES = 4
+TRIGGER_INT_REG_SOFTWARE = 0x80
+
+# Long-term statistics records (same layout as STATS_REC_* in Statistics.h)
+STATS_RECORD_SIZE = 32
+STATS_HIST_BINS = 13
+STATS_HIST_STEP = 16
+LSB_PER_G = 64.0
+SERIAL_STATUS_SIZE = 8
+SERIAL_BUFFER_SIZE = 256 + 1024 + 1024 + 64
+
+# Link layer multiplexing the UART (same as SERIAL_* in Serial.h)
+CHANNEL_CONTROL = 0
+CHANNEL_BULK = 1
+CHANNEL_STREAM = 2
+CHANNEL_EVENT = 3
+LINK_CHANNELS = 4
+LINK_RAW = 0
+LINK_MUX = 1
+LINK_SYNC = b'\xa5\x3c'
+LINK_HEADER_SIZE = 4
+LINK_CRC_SIZE = 2
+LINK_TIMEOUT = 1.0
+CHANNEL_BACKLOG = 65536
+PROFILE_SECTION_SIZE = 12
+CPU_CLOCK = 24e6
 
 
 class UART(serial.Serial):
     def __init__(self, baudrate):
         # Initialize python serial class
         super().__init__(port=self.scan_ports()[0], baudrate=baudrate, parity=serial.PARITY_NONE, stopbits=serial.STOPBITS_ONE, bytesize=serial.EIGHTBITS, timeout=0)
+        self.link_mode = LINK_RAW
+        self.link_buffer = bytearray()
+        self.link_errors = 0
+        # Without link frames all channels share the same bytes
+        self.channels = [bytearray()] * LINK_CHANNELS
 
     def scan_ports(self):
 
@@ -51,15 +173,215 @@ class UART(serial.Serial):
         # Return list of ports
         return result
 
+    def set_link_mode(self, mode):
+        # Ask for link frames, old firmware does not answer and stays raw
+        self.write(b'X' + bytes([mode]))
+        self.link_mode = mode
+        self.channels = [bytearray() for i in range(LINK_CHANNELS)] if mode == LINK_MUX else [bytearray()] * LINK_CHANNELS
+        end = time.time() + LINK_TIMEOUT
+        while time.time() < end:
+            self.poll()
+            if len(self.channels[CHANNEL_CONTROL]) > 0:
+                self.link_mode = self.channels[CHANNEL_CONTROL].pop(0)
+                return self.link_mode
+        self.link_mode = LINK_RAW
+        self.channels = [bytearray()] * LINK_CHANNELS
+        self.channels[CHANNEL_CONTROL] += self.link_buffer
+        self.link_buffer = bytearray()
+        return self.link_mode
+
+    def poll(self):
+        # Move received bytes into the buffer of their channel
+        data = self.read(max(1, self.in_waiting))
+        if self.link_mode == LINK_RAW:
+            self.channels[CHANNEL_CONTROL] += data
+        else:
+            self.link_buffer += data
+            while True:
+                start = self.link_buffer.find(LINK_SYNC)
+                if start < 0:
+                    del self.link_buffer[:-1]
+                    break
+                del self.link_buffer[:start]
+                if len(self.link_buffer) < LINK_HEADER_SIZE:
+                    break
+                channel, length = self.link_buffer[2], self.link_buffer[3]
+                size = LINK_HEADER_SIZE + length + LINK_CRC_SIZE
+                if len(self.link_buffer) < size:
+                    break
+                crc = struct.unpack('<H', self.link_buffer[size - LINK_CRC_SIZE:size])[0]
+                if channel >= len(self.channels) or binascii.crc_hqx(bytes(self.link_buffer[2:size - LINK_CRC_SIZE]), 0xFFFF) != crc:
+                    # Resync on the next sync word
+                    self.link_errors += 1
+                    del self.link_buffer[:1]
+                    continue
+                self.channels[channel] += self.link_buffer[LINK_HEADER_SIZE:size - LINK_CRC_SIZE]
+                del self.link_buffer[:size]
+
+            # Keep only recent stream bytes while nobody is monitoring
+            stream = self.channels[CHANNEL_STREAM]
+            if len(stream) > CHANNEL_BACKLOG:
+                del stream[:len(stream) - CHANNEL_BACKLOG]
+
+    def read_channel(self, channel):
+        # Read bytes received so far on a channel
+        self.poll()
+        buffer = bytes(self.channels[channel])
+        del self.channels[channel][:]
+        return buffer
+
+    def read_notifications(self):
+        # Split complete notifications pushed on the event channel (multiplexed link only)
+        if self.link_mode != LINK_MUX:
+            return []
+        self.poll()
+        buffer = self.channels[CHANNEL_EVENT]
+        count = len(buffer) // LOG_CATALOG_ENTRY_SIZE
+        entries = [bytes(buffer[i * LOG_CATALOG_ENTRY_SIZE:(i + 1) * LOG_CATALOG_ENTRY_SIZE]) for i in range(count)]
+        del buffer[:count * LOG_CATALOG_ENTRY_SIZE]
+        return entries
+
+    def read_bytes(self, n_bytes, channel=CHANNEL_CONTROL, timeout=None):
+        # Read exactly n_bytes from a channel (avoid reading null bytes), fewer if the timeout expires
+        end = time.time() + timeout if timeout is not None else None
+        while(len(self.channels[channel]) < n_bytes):
+            if end is not None and time.time() > end:
+                break
+            self.poll()
+        buffer = self.channels[channel][:n_bytes]
+        del self.channels[channel][:n_bytes]
+        return buffer
+
+
+def parse_summary(data):
+    # Per-axis peak, time from trigger to peak magnitude, per-axis RMS, time over threshold
+    peak_x, peak_y, peak_z, time_to_peak, rms_x, rms_y, rms_z, above = struct.unpack('<BBBhBBBH', bytes(data))
+    return {'peak': (peak_x, peak_y, peak_z), 'time_to_peak': time_to_peak,
+            'rms': (rms_x, rms_y, rms_z), 'above': above}
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.position = 0
+
+    def read(self, n_bits):
+        # Read n_bits MSB first
+        value = 0
+        for i in range(n_bits):
+            byte = self.data[self.position >> 3]
+            value = (value << 1) | ((byte >> (7 - (self.position & 7))) & 1)
+            self.position += 1
+        return value
+
+
+def rice_decode(data, rows):
+    # First row as it is, then k and Rice codes of the zigzag differences of each axis
+    values = [list(struct.unpack('<3b', bytes(data[0:3])))]
+    reader = BitReader(data[3:])
+    axes = []
+    for axis in range(3):
+        k = reader.read(CODEC_K_BITS)
+        value = values[0][axis]
+        axis_values = [value]
+        for row in range(1, rows):
+            # Unary quotient closed by a zero, or escape with raw value
+            quotient = 0
+            while quotient < CODEC_ESCAPE_QUOTIENT and reader.read(1):
+                quotient += 1
+            if quotient == CODEC_ESCAPE_QUOTIENT:
+                u = reader.read(CODEC_ESCAPE_BITS)
+            else:
+                u = (quotient << k) | reader.read(k)
+            # Inverse zigzag
+            value += (u >> 1) if not u & 1 else -((u + 1) >> 1)
+            axis_values.append(value)
+        axes.append(axis_values)
+    return [v for row in zip(*axes) for v in row]
+
+
+class FrameDecoder:
+    def __init__(self):
+        self.buffer = bytearray()
+        self.last_seq = None
+        self.frames = 0
+        self.lost = 0
+        self.crc_errors = 0
+        self.raw_bytes = 0
+        self.coded_bytes = 0
+
+    def feed(self, data):
+        # Append new bytes and return all complete frames
+        self.buffer += data
+        frames = []
+        while True:
+            # Resynchronize on the sync word
+            start = self.buffer.find(FRAME_SYNC)
+            if start < 0:
+                del self.buffer[:max(0, len(self.buffer) - 1)]
+                return frames
+            del self.buffer[:start]
+            if len(self.buffer) < FRAME_HEADER_SIZE:
+                return frames
+
+            frame_type, seq, timestamp, rows = struct.unpack('<BHIB', self.buffer[2:FRAME_HEADER_SIZE])
+            width = 2 if frame_type & FRAME_TYPE_WIDE else 1
+            length = FRAME_HEADER_SIZE + rows * 3 * width + FRAME_CRC_SIZE
+            if frame_type & FRAME_TYPE_RICE:
+                # Compressed samples are preceded by their length
+                if len(self.buffer) <= FRAME_HEADER_SIZE:
+                    return frames
+                length = FRAME_HEADER_SIZE + 1 + self.buffer[FRAME_HEADER_SIZE] + FRAME_CRC_SIZE
+            if length > FRAME_MAX_SIZE:
+                # Not a real header, skip sync word
+                del self.buffer[:1]
+                continue
+            if len(self.buffer) < length:
+                return frames
+
+            # Check CRC of everything after the sync word
+            crc = struct.unpack('<H', self.buffer[length - FRAME_CRC_SIZE:length])[0]
+            if binascii.crc_hqx(bytes(self.buffer[2:length - FRAME_CRC_SIZE]), 0xFFFF) != crc:
+                self.crc_errors += 1
+                del self.buffer[:1]
+                continue
+
+            # Count frames lost in between
+            if self.last_seq is not None:
+                self.lost += (seq - self.last_seq - 1) & 0xFFFF
+            self.last_seq = seq
+            self.frames += 1
+
+            payload = bytes(self.buffer[FRAME_HEADER_SIZE:length - FRAME_CRC_SIZE])
+            self.raw_bytes += rows * 3 * width
+            self.coded_bytes += len(payload)
+            if frame_type & FRAME_TYPE_RICE:
+                try:
+                    values = rice_decode(payload[1:], rows)
+                except IndexError:
+                    # Truncated codes despite the CRC
+                    self.crc_errors += 1
+                    del self.buffer[:length]
+                    continue
+            elif width == 2:
+                # Left justified 16-bit values
+                values = struct.unpack('<' + str(rows * 3) + 'h', payload)
+            else:
+                values = struct.unpack('<' + str(rows * 3) + 'b', payload)
+            frames.append({'content': frame_type & 0x0F, 'seq': seq, 'time': timestamp,
+                           'x': values[0::3], 'y': values[1::3], 'z': values[2::3]})
+            del self.buffer[:length]
+
 
 class LogMessage:
     def __init__(self, data_stream):
-        self.msg_size = 64
         self.parse_message(data_stream)
 
     def parse_message(self, stream):
         self.id = stream[0]
         self.int_reg = hex(stream[1])
+        if stream[1] & TRIGGER_INT_REG_SOFTWARE:
+            self.int_reg += " (software rule " + str(stream[1] & (TRIGGER_MAX_RULES - 1)) + ")"
         self.parse_timestamp(stream)
         self.parse_payload(stream)
 
@@ -69,35 +391,90 @@ class LogMessage:
         self.timestamp = low_reg | (high_reg << 8)
 
     def parse_payload(self, stream):
-        self.x = []
-        self.y = []
-        self.z = []
-
-        for i in range(5):
-            # Get current page data payload
-            page_data = stream[4 + i * 64: (i + 1) * 64]
-            # Append xyz data values
-            self.x += [x for x in page_data[0:self.msg_size:3]]
-            self.y += [y for y in page_data[1:self.msg_size:3]]
-            self.z += [z for z in page_data[2:self.msg_size:3]]
-
-        # Remove zero padding at the end of each data axis
-        self.x = self.x[:-4]
-        self.y = self.y[:-4]
-        self.z = self.z[:-4]
+        # Concatenate data field of all pages
+        data = bytearray()
+        for i in range(len(stream) // LOG_PAGE_SIZE):
+            data += stream[i * LOG_PAGE_SIZE + LOG_HEADER_SIZE: (i + 1) * LOG_PAGE_SIZE]
+
+        # Parse event descriptor
+        self.pages = data[0]
+        length = data[1] | (data[2] << 8)
+        self.trigger = data[3]
+        self.peak = data[4] | (data[5] << 8)
+        self.format = data[6]
+        self.core_start = data[7]
+        self.core_length = data[8]
+        self.context_rate = data[9] >> 4
+        self.core_rate = data[9] & 0x0F
+        self.summary = parse_summary(data[LOG_SUMMARY_OFFSET: LOG_SUMMARY_OFFSET + LOG_SUMMARY_SIZE])
+
+        # Get signed payload bytes (remove zero padding at the end)
+        payload = [struct.unpack('<1b', bytes([b]))[0] for b in data[LOG_DESC_SIZE: LOG_DESC_SIZE + length]]
+
+        # Get xyz data values
+        self.x, self.y, self.z = self.unpack_axes(payload, self.format)
+        self.time = self.sample_times(len(self.x))
+
+    def sample_times(self, samples):
+        # Core samples are closer in time than context samples
+        time = []
+        t = 0.0
+        for i in range(samples):
+            time.append(t)
+            in_core = self.core_start <= i < self.core_start + self.core_length
+            t += (self.core_rate if in_core else self.context_rate) / LOG_DATA_RATE
+        return time
+
+    def unpack_axes(self, payload, fmt):
+        # Dense payload made of X, Y, Z rows
+        if fmt == LOG_FORMAT_DENSE or fmt == 0:
+            return payload[0::3], payload[1::3], payload[2::3]
+
+        full_axes = [axis for axis in range(3) if fmt & (1 << axis)]
+        coarse_axes = [axis for axis in range(3) if not fmt & (1 << axis)]
+
+        # Find number of samples matching the payload length
+        samples = 0
+        while len(full_axes) * samples + len(coarse_axes) * -(-samples // LOG_COARSE_RATIO) < len(payload):
+            samples += 1
+
+        axes = [None, None, None]
+
+        # Full rate rows of the triggering axes
+        full = payload[:len(full_axes) * samples]
+        for i, axis in enumerate(full_axes):
+            axes[axis] = full[i::len(full_axes)]
+
+        # Coarse rows of the other axes, held for LOG_COARSE_RATIO samples
+        coarse = payload[len(full_axes) * samples:]
+        for i, axis in enumerate(coarse_axes):
+            axes[axis] = [v for v in coarse[i::len(coarse_axes)] for _ in range(LOG_COARSE_RATIO)][:samples]
+
+        return axes[0], axes[1], axes[2]
 
     def print_log(self):
         # Print log message header information
-        print(tabulate([[self.id, self.timestamp, self.int_reg]], ["LOG_ID", "Timestamp (s)", "INT1_REG"], tablefmt="grid"))
+        print(tabulate([[self.id, self.timestamp, self.int_reg, self.peak]], ["LOG_ID", "Timestamp (s)", "INT1_REG", "Peak [LSB^2]"], tablefmt="grid"))
+        print(tabulate([["/".join(str(v) for v in self.summary['peak']), self.summary['time_to_peak'],
+                         "/".join(str(v) for v in self.summary['rms']), self.summary['above']]],
+                       ["Peak X/Y/Z [LSB]", "Time to peak [ms]", "RMS X/Y/Z [LSB]", "Over threshold [ms]"], tablefmt="grid"))
 
-        # Setting the x coordinate as timestamp of the data, each sample every 10 ms --> 0.96s total
-        x_coord = np.arange(0, 0.96, 0.01)
+        # Setting the x coordinate as timestamp of the data (5 ms in the core window, 20 ms in the context)
+        x_coord = np.array(self.time)
 
         # potting the points
         plt.plot(x_coord, self.x)
         plt.plot(x_coord, self.y)
         plt.plot(x_coord, self.z)
 
+        # Mark the over threshold event
+        if self.trigger < len(self.time):
+            plt.axvline(self.time[self.trigger], color='k', linestyle='--')
+
+        # Mark the full rate core window
+        if self.core_length > 0:
+            plt.axvspan(self.time[self.core_start], self.time[self.core_start + self.core_length - 1], color='k', alpha=0.1)
+
         plt.ylabel('LSB [16 mg]')
         plt.xlabel('Time [s]')
         plt.legend(['x', 'y', 'z'], loc='upper left')
@@ -105,14 +482,66 @@ class LogMessage:
         plt.show()
 
 
+class EepromImage:
+    # Offline view of a dumped EEPROM image, mapped in memory (file offset = EEPROM address)
+    def __init__(self, path):
+        self.file = open(path, 'rb')
+        self.data = mmap.mmap(self.file.fileno(), 0, access=mmap.ACCESS_READ)
+
+    def close(self):
+        self.data.close()
+        self.file.close()
+
+    def ctrl_reg(self):
+        return self.data[0]
+
+    def log_counters(self):
+        # Written log pages, number of logs and next log ID
+        pages = struct.unpack_from('<H', self.data, CTRL_REG_LOG_PAGES)[0]
+        return pages, self.data[CTRL_REG_LOG_COUNT], self.data[CTRL_REG_LOG_NEXT_ID]
+
+    def logs(self):
+        # Jump from one log descriptor to the next one (like the firmware catalog)
+        pages, count, next_id = self.log_counters()
+        index = 0
+        while index < pages:
+            addr = LOG_DATA_BASE_ADDR + index * LOG_PAGE_SIZE
+            n_pages = self.data[addr + LOG_HEADER_SIZE]
+            if n_pages == 0 or addr + n_pages * LOG_PAGE_SIZE > STATS_RING_BASE_ADDR:
+                break
+            yield LogMessage(self.data[addr: addr + n_pages * LOG_PAGE_SIZE])
+            index += n_pages
+
+    def stats_records(self):
+        # Raw records of the statistics ring (validity is checked by the reader)
+        for addr in range(STATS_RING_BASE_ADDR, STATS_RING_BASE_ADDR + STATS_RING_SIZE, STATS_RECORD_SIZE):
+            yield self.data[addr: addr + STATS_RECORD_SIZE]
+
+
 class PsocController:
     def __init__(self):
         self.log_number = 0
+        self.collected = {}
+
+    def notification_row(self, entry):
+        # Same layout as catalog entries: ID, pages, peak, INT1_SRC, timestamp and summary
+        log_id, pages, peak, int_reg, timestamp = struct.unpack('<BBHBH', entry[0:7])
+        summary = parse_summary(entry[7:])
+        return [log_id, pages, peak, hex(int_reg), timestamp,
+                "/".join(str(v) for v in summary['peak']), "/".join(str(v) for v in summary['rms']), summary['above']]
+
+    def print_notifications(self):
+        # Events stored since the last command
+        rows = [self.notification_row(entry) for entry in uart_module.read_notifications()]
+        if rows:
+            print("New events stored:")
+            print(tabulate(rows, ["LOG_ID", "Pages", "Peak [LSB^2]", "INT1_REG", "Timestamp (s)",
+                                  "Peak X/Y/Z [LSB]", "RMS X/Y/Z [LSB]", "Over threshold [ms]"], tablefmt="grid"))
 
     def print_menu(self):
         print("#" * 70)
         print("\nChoose a command from the list:\n")
-        print("\tR = reset EEPROM \n\tC = request control register status of the EEPROM\n\tL = request specific log by ID\n\tN = request number of logs stored in the EEPROM\n")
+        print("\tR = reset EEPROM \n\tC = request control register status of the EEPROM\n\tL = request specific log by ID\n\tN = request number of logs stored in the EEPROM\n\tQ = request status of the RAM staging queue of events\n\tI = request catalog of stored logs with event summary, ranked and filtered\n\tP = request CPU cycles spent by profiled firmware sections\n\tD = select the stages of the DSP chain feeding LED and UART stream\n\tO = select the UART stream content (XYZ, orientation or spectrum)\n\tT = configure a software trigger rule (magnitude, jerk, RMS or band)\n\tS = request long-term statistics records\n\tU = request UART TX ring buffer counters\n\tF = select the UART stream format (legacy packets or frames)\n\tM = monitor the framed UART stream\n\tB = download all logs (or a span of IDs) in a single response\n\tE = dump the raw EEPROM image to a file\n\tW = restore the raw EEPROM image from a file\n\tV = collect new logs as soon as they are stored\n")
 
     def print_ctrl_reg(self, reg):
         # Convert the ctr_reg in fixed length binary representation
@@ -128,9 +557,7 @@ class PsocController:
                 # Write PSoC read command
                 uart_module.write(command.encode())
                 # Read PSoC response
-                res = uart_module.read()
-                while not (res):
-                    res = uart_module.read()
+                res = uart_module.read_bytes(1)
 
                 if(command == 'C'):
                     # print(res[0])
@@ -145,55 +572,388 @@ class PsocController:
                 log_id = int(input('> '))
                 # Check if there are log stored in the EEPROM
                 if(self.log_number != 0):
-                    if(log_id <= self.log_number - 1):
-                        # Send read log command and id to PSoC
-                        uart_module.write(command.encode())
-                        uart_module.write(struct.pack('B', log_id))
-
-                        # Read all log messages and store data in buffer
-                        buffer = []
-                        # Number of bytes to read via UART --> 320 bytes
-                        read_counter = 64 * 5
-                        header_list = [0, 63, 62, 61]
-                        while(read_counter > 0):
-                            # Check only valid bytes from UART (avoid reading null bytes)
-                            try:
-                                # Read byte
-                                raw_byte = uart_module.read()
-
-                                # Check if read byte is in header
-                                if((read_counter % 64) in header_list):
-                                    # Unpack as unsigned integer of 8 bit
-                                    buffer.append(struct.unpack('<1B', raw_byte)[0])
-                                # Else read byte is data --> has sign
-                                else:
-                                    # Unpack as signed integer of 8 bit
-                                    buffer.append(struct.unpack('<1b', raw_byte)[0])
-
-                                # Decrease counter
-                                read_counter -= 1
-
-                            except Exception:
-                                # Do nothing
-                                pass
-
-                        # Create log message class instance
-                        log = LogMessage(buffer)
-                        log.print_log()
-                    else:
-                        print("Wrong Log ID selected, recheck with 'N' command.\n")
+                    # Send read log command and id to PSoC (IDs are not contiguous once logs are replaced)
+                    uart_module.write(command.encode())
+                    uart_module.write(struct.pack('B', log_id))
+
+                    # Read first log page to get the number of pages of the event
+                    buffer = uart_module.read_bytes(LOG_PAGE_SIZE, CHANNEL_BULK)
+                    pages = buffer[LOG_HEADER_SIZE]
+
+                    # Log not found in the EEPROM
+                    if(pages == 0):
+                        print("Log ID not found in the EEPROM, recheck with 'I' command.\n")
+                        return
+
+                    # Read all remaining log pages
+                    buffer += uart_module.read_bytes(LOG_PAGE_SIZE * (pages - 1), CHANNEL_BULK)
+
+                    # Create log message class instance
+                    log = LogMessage(buffer)
+                    log.print_log()
                 else:
                     print("No Log actually stored in the EEPROM, recheck with 'N' command.\n")
 
+            elif(command == 'B'):
+                # Ask for the logs to download
+                for i, name in enumerate(RANGE_MODES):
+                    print("\t" + str(i) + " = " + name)
+                try:
+                    mode = int(input("Download: ") or 0)
+                    if mode == 1:
+                        selection = struct.pack('BBB', RANGE_SPAN, int(input("First ID: ")), int(input("Last ID: ")))
+                    elif mode == 2:
+                        selection = struct.pack('BBB', RANGE_NEWER, int(input("Newer than ID: ")), 0)
+                    elif mode == 0:
+                        # IDs wrap around, the whole span selects every log
+                        selection = struct.pack('BBB', RANGE_SPAN, 0, 255)
+                    else:
+                        raise ValueError
+                except (ValueError, struct.error):
+                    print("Invalid log selection")
+                    return
+
+                # Send range download command to PSoC
+                uart_module.write(command.encode() + selection)
+
+                # Read number of logs followed by ID, pages, log pages and CRC of each log
+                count = uart_module.read_bytes(1, CHANNEL_BULK)[0]
+                table = []
+                errors = 0
+                start = time.time()
+                n_bytes = 1
+                for i in range(count):
+                    header = uart_module.read_bytes(RANGE_RECORD_HEADER_SIZE, CHANNEL_BULK)
+                    pages = uart_module.read_bytes(header[1] * LOG_PAGE_SIZE, CHANNEL_BULK)
+                    crc = struct.unpack('<H', uart_module.read_bytes(RANGE_RECORD_CRC_SIZE, CHANNEL_BULK))[0]
+                    n_bytes += len(header) + len(pages) + RANGE_RECORD_CRC_SIZE
+
+                    # Check record integrity
+                    if binascii.crc_hqx(bytes(header + pages), 0xFFFF) != crc:
+                        errors += 1
+                        table.append([header[0], header[1], "-", "-", "-", "-", "-", "CRC error"])
+                        continue
+
+                    log = LogMessage(pages)
+                    table.append([log.id, log.pages, log.timestamp, log.int_reg, log.peak,
+                                  "/".join(str(v) for v in log.summary['rms']), log.summary['above'], "OK"])
+                elapsed = time.time() - start
+
+                if count == 0:
+                    # Also the answer when the given ID is the newest one
+                    print("No log selected")
+                    return
+
+                print(tabulate(table, ["LOG_ID", "Pages", "Timestamp (s)", "INT1_REG", "Peak [LSB^2]", "RMS X/Y/Z [LSB]",
+                                       "Over threshold [ms]", "CRC"], tablefmt="grid"))
+                print(str(count) + " logs, " + str(errors) + " CRC errors, " + str(n_bytes) + " bytes in " +
+                      str(round(elapsed, 2)) + " s")
+
+            elif(command == 'E' or command == 'W'):
+                # Ask for the file and the span of memory (whole memory by default)
+                try:
+                    path = input("Image file [eeprom.bin]: ") or "eeprom.bin"
+                    addr = int(input("Start address [0x0000]: ") or "0", 0)
+                    length = int(input("Length in bytes [whole memory]: ") or "0", 0)
+                    selection = struct.pack('<HH', addr, length % EEPROM_SIZE)
+                except (ValueError, struct.error):
+                    print("Invalid memory span")
+                    return
+
+                if(command == 'E'):
+                    # Send dump command to PSoC
+                    uart_module.write(command.encode() + selection)
+
+                    # Read applied span followed by blocks and their CRC
+                    addr, length = struct.unpack('<HH', uart_module.read_bytes(4, CHANNEL_BULK))
+                    length = length or EEPROM_SIZE
+                    image = bytearray(b'\xff' * EEPROM_SIZE)
+                    errors = 0
+                    start = time.time()
+                    for offset in range(addr, addr + length, IMAGE_BLOCK_SIZE):
+                        n_bytes = min(IMAGE_BLOCK_SIZE, addr + length - offset)
+                        block = uart_module.read_bytes(n_bytes, CHANNEL_BULK)
+                        crc = struct.unpack('<H', uart_module.read_bytes(IMAGE_CRC_SIZE, CHANNEL_BULK))[0]
+                        if binascii.crc_hqx(bytes(block), 0xFFFF) != crc:
+                            errors += 1
+                            print("CRC error in block at " + hex(offset))
+                        image[offset: offset + n_bytes] = block
+                    elapsed = time.time() - start
+
+                    # Image keeps EEPROM addresses as file offsets (bytes not dumped read as erased)
+                    with open(path, 'wb') as f:
+                        f.write(image)
+                    print(str(length) + " bytes from " + hex(addr) + " in " + str(round(elapsed, 2)) + " s, " +
+                          str(errors) + " CRC errors, saved to " + path)
+
+                    # Parse stored logs offline from the file
+                    dump = EepromImage(path)
+                    pages, count, next_id = dump.log_counters()
+                    print(tabulate([[hex(dump.ctrl_reg()), pages, count, next_id]], ["CTRL_REG", "Log pages", "Logs", "Next ID"], tablefmt="grid"))
+                    print(tabulate([[log.id, log.pages, log.timestamp, log.int_reg, log.peak] for log in dump.logs()],
+                                   ["LOG_ID", "Pages", "Timestamp (s)", "INT1_REG", "Peak [LSB^2]"], tablefmt="grid"))
+                    dump.close()
+                else:
+                    # Read the image to write back
+                    try:
+                        with open(path, 'rb') as f:
+                            image = f.read()
+                    except OSError:
+                        print("Unable to read " + path)
+                        return
+                    length = length or EEPROM_SIZE - addr
+                    if len(image) < addr + length:
+                        print("Image file is shorter than the selected span")
+                        return
+
+                    # Send restore command to PSoC (only whole pages are accepted)
+                    uart_module.write(command.encode() + selection)
+                    if uart_module.read_bytes(1)[0] != ord('K'):
+                        print("Restore refused, start address and length must be multiples of " + str(LOG_PAGE_SIZE))
+                        return
+
+                    # Send pages with their CRC, the next one is sent while the EEPROM writes
+                    start = time.time()
+                    for offset in range(addr, addr + length, LOG_PAGE_SIZE):
+                        page = image[offset: offset + LOG_PAGE_SIZE]
+                        for retry in range(IMAGE_RETRIES):
+                            uart_module.write(page + struct.pack('<H', binascii.crc_hqx(page, 0xFFFF)))
+                            ack = uart_module.read_bytes(1, timeout=IMAGE_ACK_TIMEOUT)
+                            if len(ack) == 0 or ack[0] == IMAGE_ABORT:
+                                # Bytes lost on the line, the PSoC gave up waiting for the page
+                                print("Restore aborted at " + hex(offset) + ", memory from this address is not restored")
+                                return
+                            if ack[0] == ord('K'):
+                                break
+                        else:
+                            print("Page at " + hex(offset) + " rejected, restore stopped")
+                            return
+                    print(str(length) + " bytes restored from " + path + " in " + str(round(time.time() - start, 2)) + " s")
+
+            elif(command == 'Q'):
+                # Send queue status command to PSoC
+                uart_module.write(command.encode())
+
+                # Read pending events and dropped events counters
+                pending, overflow, memory_full = struct.unpack('<BHH', uart_module.read_bytes(5))
+                print(tabulate([[pending, overflow, memory_full]], ["Pending events", "Dropped (queue full)", "Dropped (EEPROM full)"], tablefmt="grid"))
+
+            elif(command == 'F'):
+                # Ask for the stream format
+                for i, name in enumerate(STREAM_FORMATS):
+                    print("\t" + str(i) + " = " + name)
+                stream_format = input("Insert the stream format: ")
+                if not stream_format.isdigit() or int(stream_format) >= len(STREAM_FORMATS):
+                    print("Invalid stream format")
+                    return
+
+                # Send format command to PSoC followed by the format
+                uart_module.write(command.encode())
+                uart_module.write(bytes([int(stream_format)]))
+
+                # Read format applied by PSoC
+                applied = uart_module.read_bytes(1)[0]
+                print("UART stream format: " + STREAM_FORMATS[applied])
+
+            elif(command == 'M'):
+                # Decode frames streamed while the send flag is set
+                duration = input("Insert the monitor duration [s]: ")
+                if not duration.isdigit():
+                    print("Invalid duration")
+                    return
+
+                decoder = FrameDecoder()
+                table = []
+                end = time.time() + int(duration)
+                while time.time() < end:
+                    for frame in decoder.feed(uart_module.read_channel(CHANNEL_STREAM)):
+                        table.append([frame['seq'], frame['time'], STREAM_MODES[frame['content']].split(' ')[0] if frame['content'] < len(STREAM_MODES) else frame['content'],
+                                      len(frame['x']), max(frame['x']), max(frame['y']), max(frame['z'])])
+
+                print(tabulate(table[-20:], ["Seq", "Time [ms]", "Content", "Samples", "Max X", "Max Y", "Max Z"], tablefmt="grid"))
+                print(str(decoder.frames) + " frames, " + str(decoder.lost) + " lost, " + str(decoder.crc_errors) + " CRC errors")
+                if decoder.coded_bytes > 0:
+                    print("Compression ratio of samples: " + str(round(decoder.raw_bytes / decoder.coded_bytes, 2)))
+
+            elif(command == 'U'):
+                # Send serial status command to PSoC
+                uart_module.write(command.encode())
+
+                # Read dropped bytes, dropped packets and maximum usage of the TX ring buffers
+                dropped_bytes, dropped_writes, peak = struct.unpack('<IHH', uart_module.read_bytes(SERIAL_STATUS_SIZE))
+                print(tabulate([[dropped_bytes, dropped_writes, str(peak) + " / " + str(SERIAL_BUFFER_SIZE), uart_module.link_errors]],
+                               ["Dropped bytes", "Dropped packets", "Max queued bytes", "Link errors"], tablefmt="grid"))
+
+            elif(command == 'S'):
+                # Send statistics command to PSoC
+                uart_module.write(command.encode())
+
+                # Read number of records followed by the records from the oldest one
+                count = uart_module.read_bytes(1, CHANNEL_BULK)[0]
+                table = []
+                for i in range(count):
+                    record = uart_module.read_bytes(STATS_RECORD_SIZE, CHANNEL_BULK)
+                    seq, minutes, duration, peak = struct.unpack('<HHBB', record[0:6])
+                    axes = struct.unpack('<bbbBbbbBbbbB', record[6:18])
+                    hist = list(record[18:18 + STATS_HIST_BINS])
+                    row = [seq, minutes, duration, round(peak / LSB_PER_G, 2)]
+                    for a in range(3):
+                        row.append(" / ".join(str(v) for v in axes[a * 4:a * 4 + 4]))
+                    # Magnitude bin holding most samples
+                    mode = hist.index(max(hist))
+                    row.append(str(mode * STATS_HIST_STEP / LSB_PER_G) + "-" + str((mode + 1) * STATS_HIST_STEP / LSB_PER_G) + " g")
+                    row.append(" ".join(str(h) for h in hist))
+                    table.append(row)
+                print(tabulate(table, ["Seq", "End [min]", "Duration [min]", "Peak [g]", "X min/max/mean/rms", "Y min/max/mean/rms",
+                                       "Z min/max/mean/rms", "Most frequent", "Histogram [1/255 per 0.25 g]"], tablefmt="grid"))
+
+            elif(command == 'I'):
+                # Ask for ranking and filter of the catalog
+                for i, name in enumerate(CATALOG_SORT_KEYS):
+                    print("\t" + str(i) + " = " + name)
+                try:
+                    key = int(input("Rank logs by: ") or 0)
+                    min_above = int(input("Minimum time over threshold [ms] (empty for all): ") or 0)
+                    if key >= len(CATALOG_SORT_KEYS):
+                        raise ValueError
+                except ValueError:
+                    print("Invalid catalog filter")
+                    return
+
+                # Send catalog command to PSoC
+                uart_module.write(command.encode())
+
+                # Read number of logs followed by ID, pages, peak, INT1_SRC, timestamp and summary of each log
+                count = uart_module.read_bytes(1, CHANNEL_BULK)[0]
+                catalog = []
+                for i in range(count):
+                    entry = uart_module.read_bytes(LOG_CATALOG_ENTRY_SIZE, CHANNEL_BULK)
+                    log_id, pages, peak, int_reg, timestamp = struct.unpack('<BBHBH', entry[0:7])
+                    summary = parse_summary(entry[7:])
+                    if summary['above'] < min_above:
+                        continue
+                    catalog.append([log_id, pages, peak, hex(int_reg), timestamp,
+                                    "/".join(str(v) for v in summary['peak']), summary['time_to_peak'],
+                                    "/".join(str(v) for v in summary['rms']), summary['above'],
+                                    max(summary['rms'])])
+
+                # Highest values of the selected column first
+                sort_column = [2, 8, 9, 4][key]
+                catalog.sort(key=lambda entry: entry[sort_column], reverse=True)
+                print(tabulate([entry[:-1] for entry in catalog], ["LOG_ID", "Pages", "Peak [LSB^2]", "INT1_REG", "Timestamp (s)",
+                                                                   "Peak X/Y/Z [LSB]", "Time to peak [ms]", "RMS X/Y/Z [LSB]",
+                                                                   "Over threshold [ms]"], tablefmt="grid"))
+                print(str(len(catalog)) + " of " + str(count) + " logs shown")
+
+            elif(command == 'P'):
+                # Send profile command to PSoC
+                uart_module.write(command.encode())
+
+                # Read number of sections followed by last, max and average cycles of each section
+                count = uart_module.read_bytes(1)[0]
+                table = []
+                for i in range(count):
+                    last, peak, average = struct.unpack('<III', uart_module.read_bytes(PROFILE_SECTION_SIZE))
+                    name = PROFILE_SECTIONS[i] if i < len(PROFILE_SECTIONS) else 'Section ' + str(i)
+                    table.append([name, last, peak, average, round(average / CPU_CLOCK * 1e6, 1)])
+                print(tabulate(table, ["Section", "Last [cycles]", "Max [cycles]", "Average [cycles]", "Average [us]"], tablefmt="grid"))
+
+            elif(command == 'D'):
+                # Ask for the bit mask of the stages
+                print("Stages: " + ", ".join(str(1 << i) + " = " + name for i, name in enumerate(DSP_STAGES)) + " (0 = raw data)")
+                mask = input("Insert the sum of the desired stages: ")
+                if not mask.isdigit() or int(mask) >= (1 << len(DSP_STAGES)):
+                    print("Invalid stage mask")
+                    return
+
+                # Send DSP command to PSoC followed by the mask
+                uart_module.write(command.encode())
+                uart_module.write(bytes([int(mask)]))
+
+                # Read stages applied by PSoC
+                applied = uart_module.read_bytes(1)[0]
+                print("DSP chain: " + (" -> ".join(name for i, name in enumerate(DSP_STAGES) if applied & (1 << i)) or "raw data"))
+
+            elif(command == 'O'):
+                # Ask for the stream content
+                for i, name in enumerate(STREAM_MODES):
+                    print("\t" + str(i) + " = " + name)
+                mode = input("Insert the stream mode: ")
+                if not mode.isdigit() or int(mode) >= len(STREAM_MODES):
+                    print("Invalid stream mode")
+                    return
+
+                # Send stream command to PSoC followed by the mode
+                uart_module.write(command.encode())
+                uart_module.write(bytes([int(mode)]))
+
+                # Read mode applied by PSoC
+                applied = uart_module.read_bytes(1)[0]
+                print("UART stream: " + STREAM_MODES[applied])
+
+            elif(command == 'T'):
+                # Ask for the rule settings
+                for i, name in enumerate(TRIGGER_RULES):
+                    print("\t" + str(i) + " = " + name)
+                try:
+                    index = int(input("Insert the rule index [0-" + str(TRIGGER_MAX_RULES - 1) + "]: "))
+                    rule = int(input("Insert the rule type: "))
+                    threshold = int(input("Insert the threshold [LSB^2, LSB for band rule]: "))
+                    duration = int(input("Insert the duration [samples]: "))
+                    payload = struct.pack('<BBHB', index, rule, threshold, duration)
+                except (ValueError, struct.error):
+                    print("Invalid trigger rule")
+                    return
+
+                # Send trigger command to PSoC followed by the rule
+                uart_module.write(command.encode() + payload)
+
+                # Read PSoC response
+                ack = uart_module.read_bytes(1)[0]
+                if ack == ord('K'):
+                    print("Rule " + str(index) + ": " + TRIGGER_RULES[rule])
+                else:
+                    print("Rule not applied")
+
+            elif(command == 'V'):
+                # Notifications are pushed only over the multiplexed link
+                if uart_module.link_mode != LINK_MUX:
+                    print("Event notifications need the multiplexed link")
+                    return
+                duration = input("Insert the collection duration [s]: ")
+                if not duration.isdigit():
+                    print("Invalid duration")
+                    return
+
+                # Fetch each log as soon as it is stored, without polling 'N'
+                table = []
+                start = time.time()
+                while time.time() < start + int(duration):
+                    for entry in uart_module.read_notifications():
+                        row = self.notification_row(entry)
+                        uart_module.write(b'L' + bytes([row[0]]))
+                        buffer = uart_module.read_bytes(LOG_PAGE_SIZE, CHANNEL_BULK)
+                        if buffer[LOG_HEADER_SIZE] == 0:
+                            # Already replaced by a stronger event
+                            print("Log " + str(row[0]) + " no longer stored")
+                            continue
+                        if buffer[LOG_HEADER_SIZE] > 1:
+                            buffer += uart_module.read_bytes(LOG_PAGE_SIZE * (buffer[LOG_HEADER_SIZE] - 1), CHANNEL_BULK)
+                        self.collected[row[0]] = LogMessage(buffer)
+                        table.append(row + [round(time.time() - start, 1)])
+                        print("Log " + str(row[0]) + " collected")
+
+                print(tabulate(table, ["LOG_ID", "Pages", "Peak [LSB^2]", "INT1_REG", "Timestamp (s)",
+                                       "Peak X/Y/Z [LSB]", "RMS X/Y/Z [LSB]", "Over threshold [ms]", "Received [s]"], tablefmt="grid"))
+                print(str(len(table)) + " logs collected")
+
             elif(command == 'R'):
 
                 # Send reset command to PSoC
                 uart_module.write(command.encode())
 
                 # Read PSoC response
-                ack = uart_module.read()
-                while not (ack):
-                    ack = uart_module.read()
+                ack = uart_module.read_bytes(1)
 
                 if ack.decode() == 'K':
                     print("EEPROM log memory has been erased.")
@@ -210,8 +970,13 @@ if __name__ == "__main__":
     uart_module = UART(baudrate=BAUDRATE)
     psoc_module = PsocController()
 
+    # Split responses, downloads and stream sharing the UART
+    if uart_module.set_link_mode(LINK_MUX) == LINK_MUX:
+        print("Multiplexed link active")
+
     # Loop until connection is active
     while(uart_module.isOpen()):
+        psoc_module.print_notifications()
         psoc_module.print_menu()
         command = input('> ')
 